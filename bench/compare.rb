@@ -0,0 +1,52 @@
+# frozen_string_literal: true
+
+require 'json'
+
+module Bench
+  # Compares two result files of bench/run.rb case by case. Ratios are of the
+  # target to the base, so a time ratio below 1 is a speedup.
+  class Compare
+    def initialize(base_file, target_file)
+      @base = JSON.parse(File.read(base_file), symbolize_names: true)
+      @target = JSON.parse(File.read(target_file), symbolize_names: true)
+    end
+
+    def run
+      warn 'the runs differ in scale or seed, so the cases are not comparable' unless comparable?
+
+      base_results = @base[:results].to_h { |r| [key(r), r] }
+      puts format('%-12s %-8s %-20s %10s %10s %7s %10s %10s %7s',
+                  'dataset', 'task', 'solver', 'base s', 'target s', 'ratio', 'base kB', 'target kB', 'ratio')
+      @target[:results].each do |target|
+        base = base_results[key(target)]
+        next if base.nil?
+
+        puts format('%-12s %-8s %-20s %10.4f %10.4f %7s %10s %10s %7s',
+                    target[:dataset], target[:task], target[:solver], base[:seconds], target[:seconds],
+                    ratio(target[:seconds], base[:seconds]), base[:peak_rss_kb], target[:peak_rss_kb],
+                    ratio(target[:peak_rss_kb], base[:peak_rss_kb]))
+      end
+    end
+
+    private
+
+    def comparable?
+      %i[scale seed].all? { |field| @base[:meta][field] == @target[:meta][field] }
+    end
+
+    def key(result)
+      result.values_at(:dataset, :task, :solver)
+    end
+
+    def ratio(value, base)
+      return '-' if value.nil? || base.nil? || base.zero?
+
+      format('%.3f', value.fdiv(base))
+    end
+  end
+end
+
+if $PROGRAM_NAME == __FILE__
+  abort "usage: #{$PROGRAM_NAME} BASE.json TARGET.json" unless ARGV.size == 2
+  Bench::Compare.new(*ARGV).run
+end
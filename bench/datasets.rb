@@ -0,0 +1,69 @@
+# frozen_string_literal: true
+
+require 'numo/narray/alt'
+
+module Bench
+  # Synthetic datasets of the benchmarks. Each generator is seeded, so two runs
+  # at the same scale train on the same data.
+  module Datasets
+    # Number of samples of each dataset at each scale.
+    SCALES = {
+      'small' => { dense: 2_000, sparse_text: 2_000, wide_l1: 500, many_class: 2_000 },
+      'medium' => { dense: 10_000, sparse_text: 10_000, wide_l1: 2_000, many_class: 10_000 },
+      'large' => { dense: 50_000, sparse_text: 30_000, wide_l1: 3_000, many_class: 30_000 }
+    }.freeze
+
+    module_function
+
+    # Dense features from the standard normal distribution, with binary labels
+    # and real-valued targets of a noisy linear model.
+    def dense(n_samples, seed)
+      Numo::NArray.srand(seed)
+      x = Numo::DFloat.new(n_samples, 50).rand_norm
+      coef = Numo::DFloat.new(50).rand_norm
+      target = x.dot(coef) + (0.5 * Numo::DFloat.new(n_samples).rand_norm)
+      { x: x, y: sign_labels(target), target: target }
+    end
+
+    # Bag-of-words-like data: 2,000 features of which about 1% are nonzero in
+    # each sample, with positive term weights normalized per sample.
+    def sparse_text(n_samples, seed)
+      Numo::NArray.srand(seed)
+      x = sparse_matrix(n_samples, 2_000, 0.01)
+      norm = Numo::NMath.sqrt((x**2).sum(axis: 1, keepdims: true))
+      norm[norm.eq(0)] = 1
+      x /= norm
+      coef = Numo::DFloat.new(2_000).rand_norm
+      { x: x, y: sign_labels(x.dot(coef)) }
+    end
+
+    # More features than samples, with 20 informative features out of 10,000,
+    # for the L1-regularized solvers.
+    def wide_l1(n_samples, seed)
+      Numo::NArray.srand(seed)
+      x = sparse_matrix(n_samples, 10_000, 0.005)
+      coef = Numo::DFloat.zeros(10_000)
+      coef[0...20] = Numo::DFloat.new(20).rand_norm
+      x[true, 0...20] = Numo::DFloat.new(n_samples, 20).rand_norm
+      { x: x, y: sign_labels(x.dot(coef)) }
+    end
+
+    # 20 classes given by the largest of 20 linear scores on 100 dense features.
+    def many_class(n_samples, seed)
+      Numo::NArray.srand(seed)
+      x = Numo::DFloat.new(n_samples, 100).rand_norm
+      scores = x.dot(Numo::DFloat.new(100, 20).rand_norm)
+      { x: x, y: Numo::DFloat.cast(scores.max_index(axis: 1) % 20) }
+    end
+
+    def sparse_matrix(n_samples, n_features, density)
+      x = Numo::DFloat.new(n_samples, n_features).rand
+      x[Numo::DFloat.new(n_samples, n_features).rand >= density] = 0
+      x
+    end
+
+    def sign_labels(score)
+      (2 * Numo::DFloat.cast(score >= 0)) - 1
+    end
+  end
+end
@@ -0,0 +1,300 @@
+// Micro-benchmark of the solver kernels of LIBLINEAR on generated problems.
+//
+// linear.cpp is included as a whole, so that the kernels internal to it
+// (sparse_operator, the function objects, transpose) are called directly.
+// Each kernel is run -r times over the whole problem; the time per nonzero
+// and the bandwidth of the feature_node arrays it streams are reported.
+// The solvers are timed with train() and the counters of param.keep_stat.
+//
+// usage: kernels [-l rows] [-n features] [-d density] [-t threads] [-r repeats] [-s solver,...] [-S seed]
+
+#include "linear.cpp"
+
+#include <chrono>
+
+struct bench_option
+{
+	int l;
+	int n;
+	double density;
+	int nr_thread;
+	int repeat;
+	unsigned long long seed;
+	const char *solvers;
+};
+
+static unsigned long long rng_state;
+
+static double next_uniform()
+{
+	// xorshift64*
+	rng_state ^= rng_state >> 12;
+	rng_state ^= rng_state << 25;
+	rng_state ^= rng_state >> 27;
+	return (double)((rng_state * 2685821657736338717ULL) >> 11) / 9007199254740992.0;
+}
+
+static double now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int compare_int(const void *a, const void *b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+// rows of about n*density nonzeros at distinct random columns in increasing
+// order, and labels given by the sign of a random linear model
+static void generate_problem(const bench_option *opt, problem *prob, feature_node **x_space)
+{
+	int l = opt->l, n = opt->n;
+	rng_state = opt->seed * 0x9E3779B97F4A7C15ULL + 1;
+
+	size_t nnz = 0;
+	int *row_nnz = new int[l];
+	for(int i=0; i<l; i++)
+	{
+		double mean = n*opt->density;
+		int k = (int)(mean + (next_uniform()-0.5)*mean);
+		row_nnz[i] = min(max(k, 1), n);
+		nnz += row_nnz[i];
+	}
+
+	double *w = new double[n];
+	for(int j=0; j<n; j++)
+		w[j] = next_uniform()-0.5;
+
+	prob->l = l;
+	prob->n = n;
+	prob->bias = -1;
+	prob->y = new double[l];
+	prob->x = new feature_node*[l];
+	*x_space = new feature_node[nnz+l];
+
+	int *cols = new int[n];
+	feature_node *node = *x_space;
+	for(int i=0; i<l; i++)
+	{
+		prob->x[i] = node;
+		int k = row_nnz[i];
+		for(int s=0; s<k; s++)
+			cols[s] = (int)(next_uniform()*n);
+		qsort(cols, k, sizeof(int), compare_int);
+		double score = 0;
+		for(int s=0; s<k; s++)
+		{
+			if(s > 0 && cols[s] == cols[s-1])
+				continue;
+			node->index = cols[s]+1;
+			node->value = next_uniform();
+			score += w[cols[s]]*node->value;
+			node++;
+		}
+		(node++)->index = -1;
+		prob->y[i] = score >= 0 ? 1 : -1;
+	}
+
+	delete [] row_nnz;
+	delete [] w;
+	delete [] cols;
+}
+
+static void report(const char *kernel, double seconds, double nnz, double bytes)
+{
+	printf("%-22s %10.3f ms %8.3f ns/nnz %8.2f GB/s\n", kernel, seconds*1e3, seconds*1e9/nnz, bytes/seconds*1e-9);
+}
+
+static void bench_kernels(const bench_option *opt, const problem *prob, size_t nnz)
+{
+	int l = prob->l, n = prob->n;
+	int repeat = opt->repeat;
+	// each row streams its nonzeros and the terminating node
+	double row_bytes = (double)(nnz + l)*sizeof(feature_node);
+	double total_nnz = (double)nnz*repeat;
+	double *w = new double[n];
+	double *v = new double[l];
+	double *out = new double[max(l, n)];
+	double *C = new double[l];
+	for(int j=0; j<n; j++)
+		w[j] = 0.01*(next_uniform()-0.5);
+	for(int i=0; i<l; i++)
+	{
+		v[i] = next_uniform()-0.5;
+		C[i] = 1;
+	}
+	for(int j=0; j<max(l, n); j++)
+		out[j] = 0;
+
+	double sink = 0;
+	double start = now();
+	for(int r=0; r<repeat; r++)
+		for(int i=0; i<l; i++)
+			sink += sparse_operator::dot(w, prob->x[i]);
+	report("sparse_operator::dot", now()-start, total_nnz, row_bytes*repeat);
+
+	start = now();
+	for(int r=0; r<repeat; r++)
+		for(int i=0; i<l; i++)
+			sparse_operator::axpy(v[i], prob->x[i], out);
+	report("sparse_operator::axpy", now()-start, total_nnz, row_bytes*repeat);
+
+	parameter param;
+	memset(&param, 0, sizeof(param));
+	param.solver_type = L2R_LR;
+	param.regularize_bias = 1;
+
+	workspace ws;
+	l2r_lr_fun lr_fun(prob, &param, C, &ws);
+	start = now();
+	for(int r=0; r<repeat; r++)
+		sink += lr_fun.fun(w);
+	report("l2r_lr fun (Xv)", now()-start, total_nnz, row_bytes*repeat);
+
+	start = now();
+	for(int r=0; r<repeat; r++)
+		lr_fun.grad(w, out);
+	report("l2r_lr grad (XTv)", now()-start, total_nnz, row_bytes*repeat);
+
+	start = now();
+	for(int r=0; r<repeat; r++)
+		lr_fun.Hv(w, out);
+	report("l2r_lr Hv", now()-start, total_nnz, row_bytes*repeat);
+
+	l2r_l2_svc_fun svc_fun(prob, &param, C, &ws);
+	sink += svc_fun.fun(w);
+	svc_fun.grad(w, out);
+	start = now();
+	for(int r=0; r<repeat; r++)
+		svc_fun.Hv(w, out);
+	report("l2r_l2_svc Hv", now()-start, total_nnz, row_bytes*repeat);
+
+	// reads the rows and writes the columns
+	start = now();
+	for(int r=0; r<repeat; r++)
+	{
+		problem prob_col;
+		feature_node *x_space_col;
+		transpose(prob, &x_space_col, &prob_col, opt->nr_thread);
+		delete [] prob_col.y;
+		delete [] prob_col.x;
+		delete [] x_space_col;
+	}
+	report("transpose", now()-start, total_nnz, 2*row_bytes*repeat);
+
+	if(sink == 12345)
+		printf("%g\n", sink);
+
+	delete [] w;
+	delete [] v;
+	delete [] out;
+	delete [] C;
+}
+
+// ns/nnz of a solver is its time per iteration and nonzero; an iteration of
+// the Newton method (-s 0, 2, 11) makes a pass for each CG step, and the
+// passes of the shrinking solvers cover fewer rows
+static void bench_solvers(const bench_option *opt, const problem *prob, size_t nnz)
+{
+	printf("\n%-22s %10s %8s %8s %10s %10s\n", "solver", "ms", "iter", "CG", "ns/nnz", "Hv ms");
+	char *solvers = strdup(opt->solvers);
+	for(char *tok = strtok(solvers, ","); tok != NULL; tok = strtok(NULL, ","))
+	{
+		parameter param;
+		memset(&param, 0, sizeof(param));
+		param.solver_type = atoi(tok);
+		param.C = 1;
+		param.p = 0.1;
+		param.nu = 0.5;
+		param.regularize_bias = 1;
+		param.nr_thread = opt->nr_thread;
+		param.keep_stat = true;
+		switch(param.solver_type)
+		{
+			case L2R_LR: case L2R_L2LOSS_SVC: case L1R_L2LOSS_SVC: case L1R_LR: case ONECLASS_SVM:
+				param.eps = 0.01; break;
+			case L2R_L2LOSS_SVR:
+				param.eps = 0.0001; break;
+			default:
+				param.eps = 0.1; break;
+		}
+		const char *error_msg = check_parameter(prob, &param);
+		if(error_msg)
+		{
+			fprintf(stderr, "-s %s: %s\n", tok, error_msg);
+			continue;
+		}
+
+		srand(1);
+		model *model_ = train(prob, &param);
+		train_stat *stat = model_->stat;
+		char name[32];
+		snprintf(name, sizeof(name), "train -s %d", param.solver_type);
+		printf("%-22s %10.3f %8d %8d %10.3f %10.3f\n", name, stat->time*1e3, stat->nr_iter, stat->nr_cg_iter,
+			stat->time*1e9/((double)nnz*max(stat->nr_iter, 1)), stat->time_Hv*1e3);
+		free_and_destroy_model(&model_);
+	}
+	free(solvers);
+}
+
+int main(int argc, char **argv)
+{
+	bench_option opt;
+	opt.l = 100000;
+	opt.n = 10000;
+	opt.density = 0.001;
+	opt.nr_thread = 1;
+	opt.repeat = 10;
+	opt.seed = 1;
+	opt.solvers = "0,1,2,3,5,6,7";
+
+	for(int i=1; i+1<argc; i+=2)
+	{
+		if(argv[i][0] != '-')
+			break;
+		switch(argv[i][1])
+		{
+			case 'l': opt.l = atoi(argv[i+1]); break;
+			case 'n': opt.n = atoi(argv[i+1]); break;
+			case 'd': opt.density = atof(argv[i+1]); break;
+			case 't': opt.nr_thread = atoi(argv[i+1]); break;
+			case 'r': opt.repeat = atoi(argv[i+1]); break;
+			case 's': opt.solvers = argv[i+1]; break;
+			case 'S': opt.seed = strtoull(argv[i+1], NULL, 10); break;
+			default:
+				fprintf(stderr, "unknown option: %s\n", argv[i]);
+				return 1;
+		}
+	}
+	if(opt.l <= 0 || opt.n <= 0 || opt.density <= 0 || opt.nr_thread <= 0 || opt.repeat <= 0)
+	{
+		fprintf(stderr, "l, n, density, threads and repeats must be positive\n");
+		return 1;
+	}
+
+	set_print_string_function(print_null);
+
+	problem prob;
+	feature_node *x_space;
+	generate_problem(&opt, &prob, &x_space);
+	size_t nnz = 0;
+	for(int i=0; i<prob.l; i++)
+		for(feature_node *x = prob.x[i]; x->index != -1; x++)
+			nnz++;
+
+#ifdef _OPENMP
+	const char *openmp = "on";
+#else
+	const char *openmp = "off";
+#endif
+	printf("l %d n %d nnz %zu (%.2f%%) threads %d (OpenMP %s) repeats %d\n\n",
+		prob.l, prob.n, nnz, 100.0*nnz/((double)prob.l*prob.n), opt.nr_thread, openmp, opt.repeat);
+
+	bench_kernels(&opt, &prob, nnz);
+	bench_solvers(&opt, &prob, nnz);
+
+	delete [] prob.y;
+	delete [] prob.x;
+	delete [] x_space;
+	return 0;
+}
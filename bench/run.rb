@@ -0,0 +1,175 @@
+# frozen_string_literal: true
+
+require 'English'
+require 'etc'
+require 'fileutils'
+require 'json'
+require 'time'
+require 'numo/liblinear'
+require_relative 'datasets'
+
+module Bench
+  ST = Numo::Liblinear::SolverType
+
+  # Solver types trained on each dataset, by the kind of target.
+  CASES = {
+    dense: {
+      y: [ST::L2R_LR, ST::L2R_L2LOSS_SVC_DUAL, ST::L2R_L2LOSS_SVC, ST::L2R_L1LOSS_SVC_DUAL,
+          ST::L1R_L2LOSS_SVC, ST::L1R_LR, ST::L2R_LR_DUAL, ST::ONECLASS_SVM],
+      target: [ST::L2R_L2LOSS_SVR, ST::L2R_L2LOSS_SVR_DUAL, ST::L2R_L1LOSS_SVR_DUAL]
+    },
+    sparse_text: {
+      y: [ST::L2R_LR, ST::L2R_L2LOSS_SVC_DUAL, ST::L2R_L2LOSS_SVC, ST::L2R_L1LOSS_SVC_DUAL, ST::L2R_LR_DUAL]
+    },
+    wide_l1: {
+      y: [ST::L1R_L2LOSS_SVC, ST::L1R_LR]
+    },
+    many_class: {
+      y: [ST::L2R_L2LOSS_SVC_DUAL, ST::MCSVM_CS, ST::L2R_LR]
+    }
+  }.freeze
+
+  SOLVER_NAMES = ST.constants.to_h { |name| [ST.const_get(name), name.to_s] }.freeze
+
+  # Times training of each solver type, cross validation and batch prediction
+  # on the synthetic datasets, and writes the results to a JSON file.
+  #
+  # Every case runs in a forked process where fork is available, so that the
+  # peak RSS of a case is not hidden by the earlier ones. The seconds are the
+  # median of the repetitions. For training, convert_seconds is the time out of
+  # the solvers, which is mostly the conversion of the data into LIBLINEAR's
+  # format, and native_peak_bytes the peak of model[:stat][:memory].
+  class Runner
+    def initialize(scale:, repeat:, seed:, nr_thread:, filter:, output:)
+      @scale = scale
+      @repeat = repeat
+      @seed = seed
+      @nr_thread = nr_thread
+      @filter = filter
+      @output = output
+    end
+
+    def run
+      results = []
+      Datasets::SCALES.fetch(@scale).each do |name, n_samples|
+        next if @filter && !name.to_s.match?(@filter)
+
+        data = Datasets.public_send(name, n_samples, @seed)
+        info = { dataset: name.to_s, n_samples: data[:x].shape[0], n_features: data[:x].shape[1],
+                 nnz: data[:x].ne(0).count }
+        CASES[name].each do |target, solver_types|
+          y = data[target]
+          solver_types.each { |solver_type| results << report(info.merge(task: 'train'), measure_train(data[:x], y, solver_type)) }
+          results << report(info.merge(task: 'cv'), measure_cv(data[:x], y, solver_types.first))
+          results << report(info.merge(task: 'predict'), measure_predict(data[:x], y, solver_types.first))
+        end
+      end
+      write(results)
+    end
+
+    private
+
+    def param(solver_type)
+      { solver_type: solver_type, C: 1, nr_thread: @nr_thread, random_seed: @seed }
+    end
+
+    def measure_train(x, y, solver_type)
+      isolated do
+        runs = Array.new(@repeat) do
+          model, seconds = timed { Numo::Liblinear.train(x, y, param(solver_type).merge(keep_stat: true)) }
+          { seconds: seconds, solve_seconds: model[:stat][:time], convert_seconds: seconds - model[:stat][:time],
+            iterations: model[:stat][:nr_iter], native_peak_bytes: model[:stat][:memory][:peak] }
+        end
+        %i[seconds solve_seconds convert_seconds iterations native_peak_bytes].to_h { |key| [key, median(runs.map { |r| r[key] })] }
+          .merge(solver_type: solver_type, samples_per_sec: x.shape[0] / median(runs.map { |r| r[:seconds] }))
+      end
+    end
+
+    def measure_cv(x, y, solver_type)
+      isolated do
+        seconds = median(Array.new(@repeat) { timed { Numo::Liblinear.cv(x, y, param(solver_type), 5) }.last })
+        { solver_type: solver_type, seconds: seconds, samples_per_sec: x.shape[0] / seconds }
+      end
+    end
+
+    def measure_predict(x, y, solver_type)
+      isolated do
+        model = Numo::Liblinear.train(x, y, param(solver_type))
+        seconds = median(Array.new(@repeat) { timed { Numo::Liblinear.predict(x, param(solver_type), model) }.last })
+        { solver_type: solver_type, seconds: seconds, samples_per_sec: x.shape[0] / seconds }
+      end
+    end
+
+    def timed
+      start = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+      result = yield
+      [result, Process.clock_gettime(Process::CLOCK_MONOTONIC) - start]
+    end
+
+    def median(values)
+      sorted = values.sort
+      mid = sorted.size / 2
+      sorted.size.odd? ? sorted[mid] : (sorted[mid - 1] + sorted[mid]) / 2.0
+    end
+
+    # Runs the block in a child process and adds the RSS at its start and its peak RSS in kB.
+    def isolated
+      return yield.merge(base_rss_kb: nil, peak_rss_kb: nil) unless Process.respond_to?(:fork) && !Gem.win_platform?
+
+      reader, writer = IO.pipe
+      pid = fork do
+        reader.close
+        base_rss_kb = proc_status_kb('VmRSS')
+        result = yield
+        writer.write(JSON.generate(result.merge(base_rss_kb: base_rss_kb, peak_rss_kb: proc_status_kb('VmHWM'))))
+        writer.close
+        exit!(0)
+      rescue StandardError => e
+        warn e.full_message
+        exit!(1)
+      end
+      writer.close
+      output = reader.read
+      reader.close
+      Process.wait(pid)
+      raise "benchmark process failed with #{$CHILD_STATUS}" unless $CHILD_STATUS.success?
+
+      JSON.parse(output, symbolize_names: true)
+    end
+
+    # kB of a field of /proc/self/status on Linux, or nil elsewhere.
+    def proc_status_kb(field)
+      line = File.foreach('/proc/self/status').find { |l| l.start_with?("#{field}:") }
+      line ? line.split[1].to_i : nil
+    rescue SystemCallError
+      nil
+    end
+
+    def report(info, result)
+      entry = info.merge(solver: SOLVER_NAMES[result[:solver_type]]).merge(result)
+      warn format('%<dataset>-12s %<task>-8s %<solver>-20s %<seconds>10.4f s %<samples_per_sec>12.1f samples/s', entry)
+      entry
+    end
+
+    def write(results)
+      meta = { scale: @scale, repeat: @repeat, seed: @seed, nr_thread: @nr_thread,
+               numo_liblinear: Numo::Liblinear::VERSION, liblinear: Numo::Liblinear::LIBLINEAR_VERSION,
+               ruby: RUBY_DESCRIPTION, nprocessors: Etc.nprocessors, time: Time.now.utc.iso8601 }
+      FileUtils.mkdir_p(File.dirname(@output))
+      File.write(@output, JSON.pretty_generate({ meta: meta, results: results }))
+      warn "wrote #{@output}"
+    end
+  end
+end
+
+if $PROGRAM_NAME == __FILE__
+  scale = ENV.fetch('BENCH_SCALE', 'small')
+  Bench::Runner.new(
+    scale: scale,
+    repeat: ENV.fetch('BENCH_REPEAT', '3').to_i,
+    seed: ENV.fetch('BENCH_SEED', '1').to_i,
+    nr_thread: ENV.fetch('BENCH_THREADS', '1').to_i,
+    filter: ENV.fetch('BENCH_FILTER', nil),
+    output: ENV.fetch('BENCH_OUTPUT') { File.join(__dir__, 'results', "#{scale}-#{Time.now.strftime('%Y%m%d-%H%M%S')}.json") }
+  ).run
+end
@@ -26,8 +26,26 @@ if RUBY_PLATFORM.match?(/darwin/) && Gem::Version.new('3.1.0') <= Gem::Version.n
   end
 end
 
+use_system_blas = false
+if enable_config('system-blas', false)
+  use_system_blas = %w[openblas blis].any? { |lib| have_library(lib, 'ddot_') }
+  warn 'BLAS library is not found, so the bundled BLAS functions are used instead.' unless use_system_blas
+end
+
+# enables the multi-threaded solvers selected with the nr_thread parameter.
+if enable_config('openmp', true) && try_link("#include <omp.h>\nint main(void) { return omp_get_max_threads(); }", '-fopenmp')
+  $CXXFLAGS << ' -fopenmp'
+  $LDFLAGS << ' -fopenmp'
+end
+
+# the thread reading the next block in train_blocks.
+$LDFLAGS << ' -pthread' if try_link('int main(void) { return 0; }', '-pthread')
+
+# allows the compiler to vectorize the loops calling exp and log functions in vmath.h.
+$CXXFLAGS << ' -fno-trapping-math' if try_cflags('-fno-trapping-math')
+
 $srcs = Dir.glob("#{$srcdir}/**/*.cpp").map { |path| File.basename(path) }
-$srcs.concat(%w[daxpy.c ddot.c dnrm2.c dscal.c])
+$srcs.concat(%w[daxpy.c ddot.c dnrm2.c dscal.c]) unless use_system_blas
 
 $INCFLAGS << " -I$(srcdir)/src"
 $VPATH << "$(srcdir)/src"
@@ -113,6 +113,107 @@ extern "C" void Init_liblinearext(void) {
    * @return [Hash] The model obtained from the training procedure.
    */
   rb_define_module_function(mLiblinear, "train", RUBY_METHOD_FUNC(numo_liblinear_train), 3);
+  /**
+   * Train the models at the given values of C in order. Each training starts from the solution at the previous value:
+   * the primal solvers from its weight vector, and the dual solvers from its dual variables scaled by the ratio of C.
+   * Giving the values of C in increasing order works best.
+   *
+   * @overload train_path(x, y, param, cs) -> Array<Hash>
+   *   @param x [Numo::DFloat] (shape: [n_samples, n_features]) The samples to be used for training the model.
+   *   @param y [Numo::DFloat] (shape: [n_samples]) The labels or target values for samples.
+   *   @param param [Hash] The parameters of a model. The value of C is replaced with each value of cs.
+   *   @param cs [Numo::DFloat] (shape: [n_values]) The values of C.
+   *
+   * @example
+   *   require 'numo/liblinear'
+   *
+   *   # x: samples
+   *   # y: labels
+   *
+   *   # Train L2-regularized logistic regression at five values of C.
+   *   param = { solver_type: Numo::Liblinear::SolverType::L2R_LR }
+   *   cs = Numo::DFloat[0.01, 0.1, 1, 10, 100]
+   *   models = Numo::Liblinear.train_path(x, y, param, cs)
+   *
+   *   # Predict labels of test data with the model at C = 1.
+   *   result = Numo::Liblinear.predict(x_test, param.merge(C: cs[2]), models[2])
+   *
+   * @raise [ArgumentError] If the sample array is not 2-dimensional, the label array is not 1-dimensional,
+   *   the sample array and label array do not have the same number of samples, the values of C are not
+   *   given as a non-empty 1-dimensional array, or the hyperparameter has an invalid value, this error is raised.
+   * @return [Array<Hash>] The models obtained at the values of C.
+   */
+  rb_define_module_function(mLiblinear, "train_path", RUBY_METHOD_FUNC(numo_liblinear_train_path), 4);
+  /**
+   * Estimate the peak memory of training before converting the samples, for example to reject a job that
+   * does not fit in the memory. The bytes are those of the input arrays, the problem converted into LIBLINEAR's
+   * format, and the largest bytes allocated by training in each phase, in the same form as model[:stat][:memory]
+   * of a model trained with keep_stat: true. A dual solver that may switch to the Newton method is counted
+   * with the arrays of both, and MCSVM_CS with the dual variables of all samples and classes, although it keeps
+   * only the nonzero ones, so the estimate is an upper bound for such a solver.
+   *
+   * @overload estimate_memory(shape, nnz, param, n_classes) -> Hash
+   *   @param shape [Array<Integer>] The number of samples and features of the samples to be used for training.
+   *   @param nnz [Integer] The number of nonzero values in the samples.
+   *   @param param [Hash] The parameters of a model.
+   *   @param n_classes [Integer] The number of classes; ignored for regression and one-class SVM.
+   *
+   * @example
+   *   require 'numo/liblinear'
+   *
+   *   param = { solver_type: Numo::Liblinear::SolverType::MCSVM_CS }
+   *   memory = Numo::Liblinear.estimate_memory([100_000, 1_000], 5_000_000, param, 100)
+   *   raise 'the training does not fit in 4 GiB' if memory[:peak] > 4 * 1024**3
+   *
+   * @raise [ArgumentError] If the shape is not an array of two positive integers, the number of nonzero values
+   *   exceeds the size of the shape, or the number of classes is not positive, this error is raised.
+   * @return [Hash] The bytes of :input, :problem, the phases of training (:setup, :transpose, :solve),
+   *   and :peak, the sum of the input, the problem and the largest phase.
+   */
+  rb_define_module_function(mLiblinear, "estimate_memory", RUBY_METHOD_FUNC(numo_liblinear_estimate_memory), 4);
+  /**
+   * Append the samples and labels to a binary file as a block for train_blocks. Splitting a dataset
+   * that does not fit in the memory into parts, and saving each part in turn, gives a file of the whole dataset.
+   * The file is in the byte order of the machine, so it is not meant to be moved to another platform.
+   *
+   * @overload save_block(filename, x, y) -> Boolean
+   *   @param filename [String] The path to a file to append the block.
+   *   @param x [Numo::DFloat] (shape: [n_samples, n_features]) The samples of the block.
+   *   @param y [Numo::DFloat] (shape: [n_samples]) The labels or target values for samples.
+   *
+   * @raise [ArgumentError] If the sample array is not 2-dimensional, the label array is not 1-dimensional, or
+   *   the sample array and label array do not have the same number of samples, this error is raised.
+   * @raise [IOError] This error raises when failed to write the file.
+   * @return [Boolean] true on success.
+   */
+  rb_define_module_function(mLiblinear, "save_block", RUBY_METHOD_FUNC(numo_liblinear_save_block), 3);
+  /**
+   * Train the model on the blocks of a file written by save_block, holding only two blocks of samples in the
+   * memory: the one being solved, and the next one, which is read in the meantime. Each outer iteration runs
+   * the dual coordinate descent solver on the blocks in turn until every block is optimal.
+   * The weight vector and the dual variables of all samples stay in the memory.
+   * Only the dual solvers (L2R_L2LOSS_SVC_DUAL, L2R_L1LOSS_SVC_DUAL, L2R_LR_DUAL, L2R_L2LOSS_SVR_DUAL and
+   * L2R_L1LOSS_SVR_DUAL) are supported, without init_alpha.
+   *
+   * @overload train_blocks(filename, param) -> Hash
+   *   @param filename [String] The path to a file written by save_block.
+   *   @param param [Hash] The parameters of a model.
+   *
+   * @example
+   *   require 'numo/liblinear'
+   *
+   *   # Save the dataset in parts.
+   *   parts.each { |x, y| Numo::Liblinear.save_block('train.blk', x, y) }
+   *
+   *   # Train L2-regularized L2-loss SVM on the blocks.
+   *   param = { solver_type: Numo::Liblinear::SolverType::L2R_L2LOSS_SVC_DUAL }
+   *   model = Numo::Liblinear.train_blocks('train.blk', param)
+   *
+   * @raise [ArgumentError] If the hyperparameter has an invalid value or the solver is not supported, this error is raised.
+   * @raise [IOError] This error raises when failed to read the file, or the file is not written by save_block.
+   * @return [Hash] The model obtained from the training procedure.
+   */
+  rb_define_module_function(mLiblinear, "train_blocks", RUBY_METHOD_FUNC(numo_liblinear_train_blocks), 2);
   /**
    * Perform cross validation under given parameters. The given samples are separated to n_fols folds.
    * The predicted labels or values in the validation process are returned.
@@ -175,6 +276,94 @@ extern "C" void Init_liblinearext(void) {
    * @return [Numo::DFloat] (shape: [n_samples, n_classes]) The decision value of each sample.
    */
   rb_define_module_function(mLiblinear, "decision_function", RUBY_METHOD_FUNC(numo_liblinear_decision_function), 3);
+  /**
+   * Predict the k best class labels of given samples with their decision values, best first.
+   * The labels are selected per sample without the full matrix of decision values, and the
+   * decision values are taken from the nonzero weights of each class when the model is sparse.
+   *
+   * @overload predict_top_k(x, param, model, k) -> Array<Numo::DFloat>
+   *   @param x [Numo::DFloat] (shape: [n_samples, n_features]) The samples to predict the labels.
+   *   @param param [Hash] The parameters of the trained classification model.
+   *   @param model [Hash] The model obtained from the training procedure.
+   *   @param k [Integer] The number of labels per sample, at most the number of classes.
+   *
+   * @raise [ArgumentError] If the sample array is not 2-dimensional, k is not positive or the model is
+   *   not a classifier, this error is raised.
+   * @return [Array<Numo::DFloat>] The labels (shape: [n_samples, k]) and their decision values (shape: [n_samples, k]).
+   */
+  rb_define_module_function(mLiblinear, "predict_top_k", RUBY_METHOD_FUNC(numo_liblinear_predict_top_k), 4);
+  /**
+   * Predict the labels or values of given samples with each of several models in one pass over each sample.
+   * The weights of the models are stacked into one matrix, so each sample is converted and read once
+   * rather than once per model.
+   *
+   * @overload predict_ensemble(x, params, models) -> Numo::DFloat
+   *   @param x [Numo::DFloat] (shape: [n_samples, n_features]) The samples to calculate the scores.
+   *   @param params [Array<Hash>] The parameters of the trained models.
+   *   @param models [Array<Hash>] The binary classification, regression or one-class models.
+   *
+   * @raise [ArgumentError] If the sample array is not 2-dimensional, the numbers of parameters and models
+   *   differ, a model has more than two classes, or the models with a bias term differ in its value or in
+   *   the number of features, this error is raised.
+   * @return [Numo::DFloat] (shape: [n_samples, n_models]) The predicted label or value of each sample by each model.
+   */
+  rb_define_module_function(mLiblinear, "predict_ensemble", RUBY_METHOD_FUNC(numo_liblinear_predict_ensemble), 3);
+  /**
+   * Calculate the decision values of given samples with each of several models in one pass over each sample.
+   *
+   * @overload decision_function_ensemble(x, params, models) -> Numo::DFloat
+   *   @param x [Numo::DFloat] (shape: [n_samples, n_features]) The samples to calculate the scores.
+   *   @param params [Array<Hash>] The parameters of the trained models.
+   *   @param models [Array<Hash>] The binary classification, regression or one-class models.
+   *
+   * @raise [ArgumentError] If the sample array is not 2-dimensional, the numbers of parameters and models
+   *   differ, a model has more than two classes, or the models with a bias term differ in its value or in
+   *   the number of features, this error is raised.
+   * @return [Numo::DFloat] (shape: [n_samples, n_models]) The decision value of each sample by each model.
+   */
+  rb_define_module_function(mLiblinear, "decision_function_ensemble", RUBY_METHOD_FUNC(numo_liblinear_decision_function_ensemble),
+                            3);
+  /**
+   * Round the weights of a trained model to 8- or 16-bit integers with a scale per class.
+   * The quantized model takes an eighth or a quarter of the memory of the weights, and
+   * its max_error is the largest deviation of a decision value from that of the model
+   * over the given samples.
+   *
+   * @overload quantize(x, param, model, bits) -> Hash
+   *   @param x [Numo::DFloat] (shape: [n_samples, n_features]) The samples to measure the error of the rounding.
+   *   @param param [Hash] The parameters of the trained model.
+   *   @param model [Hash] The model obtained from the training procedure.
+   *   @param bits [Integer] The width of the integers, 8 or 16.
+   *
+   * @raise [ArgumentError] If the sample array is not 2-dimensional or bits is neither 8 nor 16, this error is raised.
+   * @return [Hash] The quantized model with the weights w (shape: [n_classes, n_features]) and their scale.
+   */
+  rb_define_module_function(mLiblinear, "quantize", RUBY_METHOD_FUNC(numo_liblinear_quantize), 4);
+  /**
+   * Predict class labels or values for given samples with a quantized model.
+   *
+   * @overload predict_quantized(x, qmodel) -> Numo::DFloat
+   *   @param x [Numo::DFloat] (shape: [n_samples, n_features]) The samples to calculate the scores.
+   *   @param qmodel [Hash] The model obtained from quantize.
+   *
+   * @raise [ArgumentError] If the sample array is not 2-dimensional or its number of features differs from
+   *   that of the model, this error is raised.
+   * @return [Numo::DFloat] (shape: [n_samples]) The predicted class label or value of each sample.
+   */
+  rb_define_module_function(mLiblinear, "predict_quantized", RUBY_METHOD_FUNC(numo_liblinear_predict_quantized), 2);
+  /**
+   * Calculate decision values for given samples with a quantized model.
+   *
+   * @overload decision_function_quantized(x, qmodel) -> Numo::DFloat
+   *   @param x [Numo::DFloat] (shape: [n_samples, n_features]) The samples to calculate the scores.
+   *   @param qmodel [Hash] The model obtained from quantize.
+   *
+   * @raise [ArgumentError] If the sample array is not 2-dimensional or its number of features differs from
+   *   that of the model, this error is raised.
+   * @return [Numo::DFloat] (shape: [n_samples, n_classes]) The decision value of each sample.
+   */
+  rb_define_module_function(mLiblinear, "decision_function_quantized", RUBY_METHOD_FUNC(numo_liblinear_decision_function_quantized),
+                            2);
   /**
    * Predict class probability for given samples.
    * The model must have probability information calcualted in training procedure.
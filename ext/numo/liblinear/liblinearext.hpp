@@ -31,6 +31,7 @@
 #ifndef LIBLINEAREXT_HPP
 #define LIBLINEAREXT_HPP 1
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 
@@ -158,10 +159,70 @@ LibLinearModel* convertHashToLibLinearModel(VALUE model_hash) {
   model->bias = NUM2DBL(el);
   el = rb_hash_aref(model_hash, ID2SYM(rb_intern("rho")));
   model->rho = NUM2DBL(el);
+  model->alpha = NULL;
+  model->nr_alpha = 0;
+  el = rb_hash_aref(model_hash, ID2SYM(rb_intern("stopped_early")));
+  model->stopped_early = RTEST(el) ? true : false;
+  model->stat = NULL;
   return model;
 }
 
-VALUE convertLibLinearModelToHash(const LibLinearModel* const model) {
+VALUE convertPeakBytesToHash(const size_t* const peak_bytes, const size_t input_bytes, const size_t problem_bytes) {
+  const size_t peak_phase = *std::max_element(peak_bytes, peak_bytes + NR_MEM_PHASE);
+  VALUE memory_hash = rb_hash_new();
+  rb_hash_aset(memory_hash, ID2SYM(rb_intern("input")), SIZET2NUM(input_bytes));
+  rb_hash_aset(memory_hash, ID2SYM(rb_intern("problem")), SIZET2NUM(problem_bytes));
+  rb_hash_aset(memory_hash, ID2SYM(rb_intern("setup")), SIZET2NUM(peak_bytes[MEM_SETUP]));
+  rb_hash_aset(memory_hash, ID2SYM(rb_intern("transpose")), SIZET2NUM(peak_bytes[MEM_TRANSPOSE]));
+  rb_hash_aset(memory_hash, ID2SYM(rb_intern("solve")), SIZET2NUM(peak_bytes[MEM_SOLVE]));
+  rb_hash_aset(memory_hash, ID2SYM(rb_intern("peak")), SIZET2NUM(input_bytes + problem_bytes + peak_phase));
+  return memory_hash;
+}
+
+VALUE convertTrainStatToHash(const struct train_stat* const stat, const size_t input_bytes, const size_t problem_bytes) {
+  const int n_iters = stat->nr_iter;
+  size_t shape[1] = {(size_t)n_iters};
+  VALUE solve_val = rb_narray_new(numo_cInt32, 1, shape);
+  VALUE iter_val = rb_narray_new(numo_cInt32, 1, shape);
+  VALUE obj_val = rb_narray_new(numo_cDFloat, 1, shape);
+  VALUE gnorm_val = rb_narray_new(numo_cDFloat, 1, shape);
+  VALUE active_size_val = rb_narray_new(numo_cInt32, 1, shape);
+  int32_t* solve_ptr = (int32_t*)na_get_pointer_for_write(solve_val);
+  int32_t* iter_ptr = (int32_t*)na_get_pointer_for_write(iter_val);
+  double* obj_ptr = (double*)na_get_pointer_for_write(obj_val);
+  double* gnorm_ptr = (double*)na_get_pointer_for_write(gnorm_val);
+  int32_t* active_size_ptr = (int32_t*)na_get_pointer_for_write(active_size_val);
+  for (int i = 0; i < n_iters; i++) {
+    solve_ptr[i] = (int32_t)stat->trace[i].solve;
+    iter_ptr[i] = (int32_t)stat->trace[i].iter;
+    obj_ptr[i] = stat->trace[i].obj;
+    gnorm_ptr[i] = stat->trace[i].gnorm;
+    active_size_ptr[i] = (int32_t)stat->trace[i].active_size;
+  }
+
+  VALUE trace_hash = rb_hash_new();
+  rb_hash_aset(trace_hash, ID2SYM(rb_intern("solve")), solve_val);
+  rb_hash_aset(trace_hash, ID2SYM(rb_intern("iter")), iter_val);
+  rb_hash_aset(trace_hash, ID2SYM(rb_intern("obj")), obj_val);
+  rb_hash_aset(trace_hash, ID2SYM(rb_intern("gnorm")), gnorm_val);
+  rb_hash_aset(trace_hash, ID2SYM(rb_intern("active_size")), active_size_val);
+
+  VALUE stat_hash = rb_hash_new();
+  rb_hash_aset(stat_hash, ID2SYM(rb_intern("nr_solve")), INT2NUM(stat->nr_solve));
+  rb_hash_aset(stat_hash, ID2SYM(rb_intern("nr_iter")), INT2NUM(stat->nr_iter));
+  rb_hash_aset(stat_hash, ID2SYM(rb_intern("nr_cg_iter")), INT2NUM(stat->nr_cg_iter));
+  rb_hash_aset(stat_hash, ID2SYM(rb_intern("nr_linesearch")), INT2NUM(stat->nr_linesearch));
+  rb_hash_aset(stat_hash, ID2SYM(rb_intern("time")), DBL2NUM(stat->time));
+  rb_hash_aset(stat_hash, ID2SYM(rb_intern("time_Xv")), DBL2NUM(stat->time_Xv));
+  rb_hash_aset(stat_hash, ID2SYM(rb_intern("time_XTv")), DBL2NUM(stat->time_XTv));
+  rb_hash_aset(stat_hash, ID2SYM(rb_intern("time_Hv")), DBL2NUM(stat->time_Hv));
+  rb_hash_aset(stat_hash, ID2SYM(rb_intern("trace")), trace_hash);
+  rb_hash_aset(stat_hash, ID2SYM(rb_intern("memory")), convertPeakBytesToHash(stat->peak_bytes, input_bytes, problem_bytes));
+  return stat_hash;
+}
+
+VALUE convertLibLinearModelToHash(const LibLinearModel* const model, const size_t input_bytes = 0,
+                                  const size_t problem_bytes = 0) {
   const int n_cols = model->nr_class > 2 ? model->nr_class : 1;
   const int n_rows = model->nr_feature;
   VALUE model_hash = rb_hash_new();
@@ -172,9 +233,68 @@ VALUE convertLibLinearModelToHash(const LibLinearModel* const model) {
                model->label ? convertVectorXiToNArray(model->label, model->nr_class) : Qnil);
   rb_hash_aset(model_hash, ID2SYM(rb_intern("bias")), DBL2NUM(model->bias));
   rb_hash_aset(model_hash, ID2SYM(rb_intern("rho")), DBL2NUM(model->rho));
+  if (model->alpha) rb_hash_aset(model_hash, ID2SYM(rb_intern("alpha")), convertVectorXdToNArray(model->alpha, model->nr_alpha));
+  rb_hash_aset(model_hash, ID2SYM(rb_intern("stopped_early")), model->stopped_early ? Qtrue : Qfalse);
+  if (model->stat)
+    rb_hash_aset(model_hash, ID2SYM(rb_intern("stat")), convertTrainStatToHash(model->stat, input_bytes, problem_bytes));
   return model_hash;
 }
 
+VALUE convertQuantizedModelToHash(const struct quantized_model* const qm) {
+  const size_t width = qm->bits / 8;
+  size_t w_shape[2] = {(size_t)qm->nr_w, (size_t)qm->n};
+  VALUE w_val = rb_narray_new(qm->bits == 8 ? numo_cInt8 : numo_cInt16, 2, w_shape);
+  memcpy(na_get_pointer_for_write(w_val), qm->w, width * qm->nr_w * qm->n);
+  VALUE qm_hash = rb_hash_new();
+  rb_hash_aset(qm_hash, ID2SYM(rb_intern("bits")), INT2NUM(qm->bits));
+  rb_hash_aset(qm_hash, ID2SYM(rb_intern("solver_type")), INT2NUM(qm->solver_type));
+  rb_hash_aset(qm_hash, ID2SYM(rb_intern("nr_class")), INT2NUM(qm->nr_class));
+  rb_hash_aset(qm_hash, ID2SYM(rb_intern("nr_feature")), INT2NUM(qm->nr_feature));
+  rb_hash_aset(qm_hash, ID2SYM(rb_intern("w")), w_val);
+  rb_hash_aset(qm_hash, ID2SYM(rb_intern("scale")), convertVectorXdToNArray(qm->scale, qm->nr_w));
+  rb_hash_aset(qm_hash, ID2SYM(rb_intern("label")), qm->label ? convertVectorXiToNArray(qm->label, qm->nr_class) : Qnil);
+  rb_hash_aset(qm_hash, ID2SYM(rb_intern("bias")), DBL2NUM(qm->bias));
+  rb_hash_aset(qm_hash, ID2SYM(rb_intern("rho")), DBL2NUM(qm->rho));
+  rb_hash_aset(qm_hash, ID2SYM(rb_intern("max_error")), DBL2NUM(qm->max_error));
+  return qm_hash;
+}
+
+struct quantized_model* convertHashToQuantizedModel(VALUE qm_hash) {
+  struct quantized_model* qm = ALLOC(struct quantized_model);
+  VALUE el;
+  el = rb_hash_aref(qm_hash, ID2SYM(rb_intern("bits")));
+  qm->bits = NUM2INT(el);
+  el = rb_hash_aref(qm_hash, ID2SYM(rb_intern("solver_type")));
+  qm->solver_type = NUM2INT(el);
+  el = rb_hash_aref(qm_hash, ID2SYM(rb_intern("nr_class")));
+  qm->nr_class = NUM2INT(el);
+  el = rb_hash_aref(qm_hash, ID2SYM(rb_intern("nr_feature")));
+  qm->nr_feature = NUM2INT(el);
+  el = rb_hash_aref(qm_hash, ID2SYM(rb_intern("bias")));
+  qm->bias = NUM2DBL(el);
+  el = rb_hash_aref(qm_hash, ID2SYM(rb_intern("rho")));
+  qm->rho = NUM2DBL(el);
+  el = rb_hash_aref(qm_hash, ID2SYM(rb_intern("max_error")));
+  qm->max_error = !NIL_P(el) ? NUM2DBL(el) : 0.0;
+  el = rb_hash_aref(qm_hash, ID2SYM(rb_intern("label")));
+  qm->label = convertNArrayToVectorXi(el);
+  el = rb_hash_aref(qm_hash, ID2SYM(rb_intern("scale")));
+  qm->scale = convertNArrayToVectorXd(el);
+  el = rb_hash_aref(qm_hash, ID2SYM(rb_intern("w")));
+  if (CLASS_OF(el) != (qm->bits == 8 ? numo_cInt8 : numo_cInt16))
+    el = rb_funcall(qm->bits == 8 ? numo_cInt8 : numo_cInt16, rb_intern("cast"), 1, el);
+  narray_t* w_nary;
+  GetNArray(el, w_nary);
+  qm->nr_w = (int)NA_SHAPE(w_nary)[0];
+  qm->n = (int)NA_SHAPE(w_nary)[1];
+  const size_t width = qm->bits / 8;
+  qm->w = ALLOC_N(char, width * qm->nr_w * qm->n);
+  memcpy(qm->w, na_get_pointer_for_read(el), width * qm->nr_w * qm->n);
+  qm->x = ALLOC_N(char, width * qm->n);
+  RB_GC_GUARD(el);
+  return qm;
+}
+
 LibLinearParameter* convertHashToLibLinearParameter(VALUE param_hash) {
   LibLinearParameter* param = ALLOC(LibLinearParameter);
   VALUE el;
@@ -236,6 +356,18 @@ LibLinearParameter* convertHashToLibLinearParameter(VALUE param_hash) {
   param->regularize_bias = 1;
   el = rb_hash_aref(param_hash, ID2SYM(rb_intern("w_recalc")));
   param->w_recalc = !NIL_P(el) ? (RTEST(el) ? true : false) : false;
+  el = rb_hash_aref(param_hash, ID2SYM(rb_intern("nr_thread")));
+  param->nr_thread = !NIL_P(el) ? NUM2INT(el) : 1;
+  el = rb_hash_aref(param_hash, ID2SYM(rb_intern("init_alpha")));
+  param->init_alpha = !NIL_P(el) ? convertNArrayToVectorXd(el) : NULL;
+  el = rb_hash_aref(param_hash, ID2SYM(rb_intern("keep_alpha")));
+  param->keep_alpha = !NIL_P(el) ? (RTEST(el) ? true : false) : false;
+  el = rb_hash_aref(param_hash, ID2SYM(rb_intern("max_time")));
+  param->max_time = !NIL_P(el) ? NUM2DBL(el) : 0;
+  el = rb_hash_aref(param_hash, ID2SYM(rb_intern("keep_stat")));
+  param->keep_stat = !NIL_P(el) ? (RTEST(el) ? true : false) : false;
+  el = rb_hash_aref(param_hash, ID2SYM(rb_intern("neg_ratio")));
+  param->neg_ratio = !NIL_P(el) ? NUM2DBL(el) : 0;
   return param;
 }
 
@@ -253,6 +385,12 @@ VALUE convertLibLinearParameterToHash(const LibLinearParameter* const param) {
   rb_hash_aset(param_hash, ID2SYM(rb_intern("nu")), DBL2NUM(param->nu));
   rb_hash_aset(param_hash, ID2SYM(rb_intern("init_sol")), Qnil);
   rb_hash_aset(param_hash, ID2SYM(rb_intern("w_recalc")), param->w_recalc ? Qtrue : Qfalse);
+  rb_hash_aset(param_hash, ID2SYM(rb_intern("nr_thread")), INT2NUM(param->nr_thread));
+  rb_hash_aset(param_hash, ID2SYM(rb_intern("init_alpha")), Qnil);
+  rb_hash_aset(param_hash, ID2SYM(rb_intern("keep_alpha")), param->keep_alpha ? Qtrue : Qfalse);
+  rb_hash_aset(param_hash, ID2SYM(rb_intern("max_time")), DBL2NUM(param->max_time));
+  rb_hash_aset(param_hash, ID2SYM(rb_intern("keep_stat")), param->keep_stat ? Qtrue : Qfalse);
+  rb_hash_aset(param_hash, ID2SYM(rb_intern("neg_ratio")), DBL2NUM(param->neg_ratio));
   return param_hash;
 }
 
@@ -319,6 +457,43 @@ bool isProbabilisticModel(LibLinearModel* model) {
   return (model->param.solver_type == L2R_LR || model->param.solver_type == L1R_LR || model->param.solver_type == L2R_LR_DUAL);
 }
 
+bool isValidInitAlpha(VALUE param_hash, const LibLinearProblem* problem, const LibLinearParameter* param) {
+  VALUE el = rb_hash_aref(param_hash, ID2SYM(rb_intern("init_alpha")));
+  if (NIL_P(el)) return true;
+
+  // the dual variables have a column for each class with one-vs-rest, and one column otherwise.
+  int n_cols = 1;
+  if (param->solver_type != L2R_L2LOSS_SVR_DUAL && param->solver_type != L2R_L1LOSS_SVR_DUAL) {
+    int* labels = ALLOC_N(int, problem->l);
+    for (int i = 0; i < problem->l; i++) labels[i] = (int)problem->y[i];
+    std::sort(labels, labels + problem->l);
+    const int n_classes = (int)(std::unique(labels, labels + problem->l) - labels);
+    xfree(labels);
+    if (n_classes > 2) n_cols = n_classes;
+  }
+
+  narray_t* alpha_nary;
+  GetNArray(el, alpha_nary);
+  return NA_NDIM(alpha_nary) == 1 && NA_SHAPE(alpha_nary)[0] == (size_t)problem->l * n_cols;
+}
+
+size_t getInputBytes(VALUE x_val, VALUE y_val) {
+  narray_t* x_nary;
+  narray_t* y_nary;
+  GetNArray(x_val, x_nary);
+  GetNArray(y_val, y_nary);
+  return (NA_SIZE(x_nary) + NA_SIZE(y_nary)) * sizeof(double);
+}
+
+size_t getProblemBytes(const LibLinearProblem* problem) {
+  size_t n_nodes = 0;
+  for (int i = 0; i < problem->l; i++) {
+    for (const LibLinearNode* node = problem->x[i]; node->index != -1; node++) n_nodes++;
+    n_nodes++;
+  }
+  return (size_t)problem->l * (sizeof(LibLinearNode*) + sizeof(double)) + n_nodes * sizeof(LibLinearNode);
+}
+
 void deleteLibLinearModel(LibLinearModel* model) {
   if (model) {
     xfree(model->w);
@@ -330,6 +505,16 @@ void deleteLibLinearModel(LibLinearModel* model) {
   }
 }
 
+void deleteQuantizedModel(struct quantized_model* qm) {
+  if (qm) {
+    xfree(qm->label);
+    xfree(qm->w);
+    xfree(qm->scale);
+    xfree(qm->x);
+    xfree(qm);
+  }
+}
+
 void deleteLibLinearParameter(LibLinearParameter* param) {
   if (param) {
     if (param->weight_label) {
@@ -344,6 +529,10 @@ void deleteLibLinearParameter(LibLinearParameter* param) {
       xfree(param->init_sol);
       param->init_sol = NULL;
     }
+    if (param->init_alpha) {
+      xfree(param->init_alpha);
+      param->init_alpha = NULL;
+    }
     xfree(param);
     param = NULL;
   }
@@ -407,12 +596,20 @@ static VALUE numo_liblinear_train(VALUE self, VALUE x_val, VALUE y_val, VALUE pa
     rb_raise(rb_eArgError, "Invalid LIBLINEAR parameter is given: %s", err_msg);
     return Qnil;
   }
+  if (!isValidInitAlpha(param_hash, problem, param)) {
+    deleteLibLinearProblem(problem);
+    deleteLibLinearParameter(param);
+    rb_raise(rb_eArgError, "Expect initial dual variables to be 1-D array of n_samples * n_columns values.");
+    return Qnil;
+  }
 
   VALUE verbose = rb_hash_aref(param_hash, ID2SYM(rb_intern("verbose")));
   if (!RTEST(verbose)) set_print_string_function(printNull);
 
   LibLinearModel* model = train(problem, param);
-  VALUE model_hash = convertLibLinearModelToHash(model);
+  const size_t input_bytes = param->keep_stat ? getInputBytes(x_val, y_val) : 0;
+  const size_t problem_bytes = param->keep_stat ? getProblemBytes(problem) : 0;
+  VALUE model_hash = convertLibLinearModelToHash(model, input_bytes, problem_bytes);
   free_and_destroy_model(&model);
 
   deleteLibLinearProblem(problem);
@@ -424,6 +621,187 @@ static VALUE numo_liblinear_train(VALUE self, VALUE x_val, VALUE y_val, VALUE pa
   return model_hash;
 }
 
+static VALUE numo_liblinear_train_path(VALUE self, VALUE x_val, VALUE y_val, VALUE param_hash, VALUE cs_val) {
+  if (CLASS_OF(x_val) != numo_cDFloat) x_val = rb_funcall(numo_cDFloat, rb_intern("cast"), 1, x_val);
+  if (CLASS_OF(y_val) != numo_cDFloat) y_val = rb_funcall(numo_cDFloat, rb_intern("cast"), 1, y_val);
+  if (CLASS_OF(cs_val) != numo_cDFloat) cs_val = rb_funcall(numo_cDFloat, rb_intern("cast"), 1, cs_val);
+  if (!RTEST(nary_check_contiguous(x_val))) x_val = nary_dup(x_val);
+  if (!RTEST(nary_check_contiguous(y_val))) y_val = nary_dup(y_val);
+  if (!RTEST(nary_check_contiguous(cs_val))) cs_val = nary_dup(cs_val);
+
+  narray_t* x_nary;
+  narray_t* y_nary;
+  narray_t* cs_nary;
+  GetNArray(x_val, x_nary);
+  GetNArray(y_val, y_nary);
+  GetNArray(cs_val, cs_nary);
+  if (NA_NDIM(x_nary) != 2) {
+    rb_raise(rb_eArgError, "Expect samples to be 2-D array.");
+    return Qnil;
+  }
+  if (NA_NDIM(y_nary) != 1) {
+    rb_raise(rb_eArgError, "Expect label or target values to be 1-D arrray.");
+    return Qnil;
+  }
+  if (NA_SHAPE(x_nary)[0] != NA_SHAPE(y_nary)[0]) {
+    rb_raise(rb_eArgError, "Expect to have the same number of samples for samples and labels.");
+    return Qnil;
+  }
+  if (NA_NDIM(cs_nary) != 1 || NA_SHAPE(cs_nary)[0] == 0) {
+    rb_raise(rb_eArgError, "Expect values of C to be non-empty 1-D array.");
+    return Qnil;
+  }
+
+  VALUE random_seed = rb_hash_aref(param_hash, ID2SYM(rb_intern("random_seed")));
+  if (!NIL_P(random_seed)) srand(NUM2UINT(random_seed));
+
+  LibLinearParameter* param = convertHashToLibLinearParameter(param_hash);
+  LibLinearProblem* problem = convertDatasetToLibLinearProblem(x_val, y_val);
+
+  const int n_cs = (int)NA_SHAPE(cs_nary)[0];
+  const double* const cs_ptr = (double*)na_get_pointer_for_read(cs_val);
+  for (int i = 0; i < n_cs; i++) {
+    param->C = cs_ptr[i];
+    const char* err_msg = check_parameter(problem, param);
+    if (err_msg) {
+      deleteLibLinearProblem(problem);
+      deleteLibLinearParameter(param);
+      rb_raise(rb_eArgError, "Invalid LIBLINEAR parameter is given: %s", err_msg);
+      return Qnil;
+    }
+  }
+  if (!isValidInitAlpha(param_hash, problem, param)) {
+    deleteLibLinearProblem(problem);
+    deleteLibLinearParameter(param);
+    rb_raise(rb_eArgError, "Expect initial dual variables to be 1-D array of n_samples * n_columns values.");
+    return Qnil;
+  }
+
+  VALUE verbose = rb_hash_aref(param_hash, ID2SYM(rb_intern("verbose")));
+  if (!RTEST(verbose)) set_print_string_function(printNull);
+
+  LibLinearModel** models = ALLOC_N(LibLinearModel*, n_cs);
+  train_path(problem, param, n_cs, cs_ptr, models);
+  const size_t input_bytes = param->keep_stat ? getInputBytes(x_val, y_val) : 0;
+  const size_t problem_bytes = param->keep_stat ? getProblemBytes(problem) : 0;
+  VALUE models_arr = rb_ary_new2(n_cs);
+  for (int i = 0; i < n_cs; i++) {
+    rb_ary_store(models_arr, i, convertLibLinearModelToHash(models[i], input_bytes, problem_bytes));
+    free_and_destroy_model(&models[i]);
+  }
+  xfree(models);
+
+  deleteLibLinearProblem(problem);
+  deleteLibLinearParameter(param);
+
+  RB_GC_GUARD(x_val);
+  RB_GC_GUARD(y_val);
+  RB_GC_GUARD(cs_val);
+
+  return models_arr;
+}
+
+static VALUE numo_liblinear_estimate_memory(VALUE self, VALUE shape_val, VALUE nnz_val, VALUE param_hash, VALUE nr_class_val) {
+  shape_val = rb_check_array_type(shape_val);
+  if (NIL_P(shape_val) || RARRAY_LEN(shape_val) != 2) {
+    rb_raise(rb_eArgError, "Expect shape to be an array of the number of samples and features.");
+    return Qnil;
+  }
+  const long long n_samples = NUM2LL(rb_ary_entry(shape_val, 0));
+  const long long n_features = NUM2LL(rb_ary_entry(shape_val, 1));
+  const long long n_nonzeros = NUM2LL(nnz_val);
+  const int n_classes = NUM2INT(nr_class_val);
+  if (n_samples <= 0 || n_features <= 0 || n_samples > INT_MAX || n_features > INT_MAX || n_nonzeros < 0 ||
+      n_nonzeros > n_samples * n_features || n_classes <= 0) {
+    rb_raise(rb_eArgError, "Expect positive shape, nonzeros within the shape and a positive number of classes.");
+    return Qnil;
+  }
+
+  LibLinearParameter* param = convertHashToLibLinearParameter(param_hash);
+  // the converted problem pads each row with at most one zero node at the last feature.
+  const size_t nnz = (size_t)n_nonzeros + n_samples;
+  size_t peak_bytes[NR_MEM_PHASE];
+  estimate_train_memory(param, (int)n_samples, (int)n_features, nnz, n_classes, peak_bytes);
+  deleteLibLinearParameter(param);
+
+  const size_t input_bytes = (size_t)n_samples * (n_features + 1) * sizeof(double);
+  const size_t problem_bytes =
+    (size_t)n_samples * (sizeof(LibLinearNode*) + sizeof(double)) + (nnz + n_samples) * sizeof(LibLinearNode);
+  return convertPeakBytesToHash(peak_bytes, input_bytes, problem_bytes);
+}
+
+static VALUE numo_liblinear_save_block(VALUE self, VALUE filename, VALUE x_val, VALUE y_val) {
+  if (CLASS_OF(x_val) != numo_cDFloat) x_val = rb_funcall(numo_cDFloat, rb_intern("cast"), 1, x_val);
+  if (CLASS_OF(y_val) != numo_cDFloat) y_val = rb_funcall(numo_cDFloat, rb_intern("cast"), 1, y_val);
+  if (!RTEST(nary_check_contiguous(x_val))) x_val = nary_dup(x_val);
+  if (!RTEST(nary_check_contiguous(y_val))) y_val = nary_dup(y_val);
+
+  narray_t* x_nary;
+  narray_t* y_nary;
+  GetNArray(x_val, x_nary);
+  GetNArray(y_val, y_nary);
+  if (NA_NDIM(x_nary) != 2) {
+    rb_raise(rb_eArgError, "Expect samples to be 2-D array.");
+    return Qnil;
+  }
+  if (NA_NDIM(y_nary) != 1) {
+    rb_raise(rb_eArgError, "Expect label or target values to be 1-D arrray.");
+    return Qnil;
+  }
+  if (NA_SHAPE(x_nary)[0] != NA_SHAPE(y_nary)[0]) {
+    rb_raise(rb_eArgError, "Expect to have the same number of samples for samples and labels.");
+    return Qnil;
+  }
+
+  const char* const filename_ = StringValuePtr(filename);
+  LibLinearProblem* problem = convertDatasetToLibLinearProblem(x_val, y_val);
+  const int res = save_block(filename_, problem);
+  deleteLibLinearProblem(problem);
+
+  if (res < 0) {
+    rb_raise(rb_eIOError, "Failed to save file '%s'", filename_);
+    return Qfalse;
+  }
+
+  RB_GC_GUARD(filename);
+  RB_GC_GUARD(x_val);
+  RB_GC_GUARD(y_val);
+
+  return Qtrue;
+}
+
+static VALUE numo_liblinear_train_blocks(VALUE self, VALUE filename, VALUE param_hash) {
+  VALUE random_seed = rb_hash_aref(param_hash, ID2SYM(rb_intern("random_seed")));
+  if (!NIL_P(random_seed)) srand(NUM2UINT(random_seed));
+
+  LibLinearParameter* param = convertHashToLibLinearParameter(param_hash);
+
+  const char* err_msg = check_block_parameter(param);
+  if (err_msg) {
+    deleteLibLinearParameter(param);
+    rb_raise(rb_eArgError, "Invalid LIBLINEAR parameter is given: %s", err_msg);
+    return Qnil;
+  }
+
+  VALUE verbose = rb_hash_aref(param_hash, ID2SYM(rb_intern("verbose")));
+  if (!RTEST(verbose)) set_print_string_function(printNull);
+
+  const char* const filename_ = StringValuePtr(filename);
+  LibLinearModel* model = train_blocks(filename_, param);
+  deleteLibLinearParameter(param);
+  if (model == NULL) {
+    rb_raise(rb_eIOError, "Failed to load file '%s'", filename_);
+    return Qnil;
+  }
+
+  VALUE model_hash = convertLibLinearModelToHash(model);
+  free_and_destroy_model(&model);
+
+  RB_GC_GUARD(filename);
+
+  return model_hash;
+}
+
 static VALUE numo_liblinear_cross_validation(VALUE self, VALUE x_val, VALUE y_val, VALUE param_hash, VALUE nr_folds) {
   if (CLASS_OF(x_val) != numo_cDFloat) x_val = rb_funcall(numo_cDFloat, rb_intern("cast"), 1, x_val);
   if (CLASS_OF(y_val) != numo_cDFloat) y_val = rb_funcall(numo_cDFloat, rb_intern("cast"), 1, y_val);
@@ -553,6 +931,237 @@ static VALUE numo_liblinear_decision_function(VALUE self, VALUE x_val, VALUE par
   return y_val;
 }
 
+static VALUE numo_liblinear_predict_top_k(VALUE self, VALUE x_val, VALUE param_hash, VALUE model_hash, VALUE k_val) {
+  if (CLASS_OF(x_val) != numo_cDFloat) x_val = rb_funcall(numo_cDFloat, rb_intern("cast"), 1, x_val);
+  if (!RTEST(nary_check_contiguous(x_val))) x_val = nary_dup(x_val);
+
+  narray_t* x_nary;
+  GetNArray(x_val, x_nary);
+  if (NA_NDIM(x_nary) != 2) {
+    rb_raise(rb_eArgError, "Expect samples to be 2-D array.");
+    return Qnil;
+  }
+  const int k = NUM2INT(k_val);
+  if (k <= 0) {
+    rb_raise(rb_eArgError, "Expect k to be positive.");
+    return Qnil;
+  }
+
+  LibLinearParameter* param = convertHashToLibLinearParameter(param_hash);
+  LibLinearModel* model = convertHashToLibLinearModel(model_hash);
+  model->param = *param;
+
+  struct class_weights* cw = make_class_weights(model);
+  if (cw == NULL) {
+    deleteLibLinearModel(model);
+    deleteLibLinearParameter(param);
+    rb_raise(rb_eArgError, "Expect a classification model.");
+    return Qnil;
+  }
+
+  const int n_samples = (int)NA_SHAPE(x_nary)[0];
+  const int n_features = (int)NA_SHAPE(x_nary)[1];
+  const int n_best = k < model->nr_class ? k : model->nr_class;
+  size_t y_shape[2] = {(size_t)n_samples, (size_t)n_best};
+  VALUE labels_val = rb_narray_new(numo_cDFloat, 2, y_shape);
+  VALUE scores_val = rb_narray_new(numo_cDFloat, 2, y_shape);
+  const double* const x_ptr = (double*)na_get_pointer_for_read(x_val);
+  double* labels_ptr = (double*)na_get_pointer_for_write(labels_val);
+  double* scores_ptr = (double*)na_get_pointer_for_write(scores_val);
+  for (int i = 0; i < n_samples; i++) {
+    LibLinearNode* x_nodes = convertVectorXdToLibLinearNode(&x_ptr[i * n_features], n_features);
+    predict_top_k(model, cw, x_nodes, n_best, &labels_ptr[i * n_best], &scores_ptr[i * n_best]);
+    xfree(x_nodes);
+  }
+
+  free_class_weights(&cw);
+  deleteLibLinearModel(model);
+  deleteLibLinearParameter(param);
+
+  RB_GC_GUARD(x_val);
+
+  return rb_ary_new3(2, labels_val, scores_val);
+}
+
+VALUE scoreEnsemble(VALUE x_val, VALUE params_val, VALUE models_val, const bool with_labels) {
+  if (CLASS_OF(x_val) != numo_cDFloat) x_val = rb_funcall(numo_cDFloat, rb_intern("cast"), 1, x_val);
+  if (!RTEST(nary_check_contiguous(x_val))) x_val = nary_dup(x_val);
+
+  narray_t* x_nary;
+  GetNArray(x_val, x_nary);
+  if (NA_NDIM(x_nary) != 2) {
+    rb_raise(rb_eArgError, "Expect samples to be 2-D array.");
+    return Qnil;
+  }
+  Check_Type(params_val, T_ARRAY);
+  Check_Type(models_val, T_ARRAY);
+  const int n_models = (int)RARRAY_LEN(models_val);
+  if (n_models == 0 || RARRAY_LEN(params_val) != n_models) {
+    rb_raise(rb_eArgError, "Expect the same positive number of parameters and models.");
+    return Qnil;
+  }
+
+  LibLinearModel** models = ALLOC_N(LibLinearModel*, n_models);
+  for (int m = 0; m < n_models; m++) {
+    LibLinearParameter* param = convertHashToLibLinearParameter(rb_ary_entry(params_val, m));
+    models[m] = convertHashToLibLinearModel(rb_ary_entry(models_val, m));
+    // the stack takes only the solver type from the parameters.
+    models[m]->param = *param;
+    deleteLibLinearParameter(param);
+  }
+  struct model_stack* ms = stack_models(models, n_models);
+  for (int m = 0; m < n_models; m++) deleteLibLinearModel(models[m]);
+  xfree(models);
+  if (ms == NULL) {
+    rb_raise(rb_eArgError, "Expect binary classification, regression or one-class models with the same bias term.");
+    return Qnil;
+  }
+
+  const int n_samples = (int)NA_SHAPE(x_nary)[0];
+  const int n_features = (int)NA_SHAPE(x_nary)[1];
+  size_t y_shape[2] = {(size_t)n_samples, (size_t)n_models};
+  VALUE y_val = rb_narray_new(numo_cDFloat, 2, y_shape);
+  const double* const x_ptr = (double*)na_get_pointer_for_read(x_val);
+  double* y_ptr = (double*)na_get_pointer_for_write(y_val);
+  double* dec_values = with_labels ? ALLOC_N(double, n_models) : NULL;
+  for (int i = 0; i < n_samples; i++) {
+    LibLinearNode* x_nodes = convertVectorXdToLibLinearNode(&x_ptr[i * n_features], n_features);
+    if (with_labels) {
+      predict_stack(ms, x_nodes, dec_values, &y_ptr[i * n_models]);
+    } else {
+      predict_stack(ms, x_nodes, &y_ptr[i * n_models], NULL);
+    }
+    xfree(x_nodes);
+  }
+
+  if (dec_values) xfree(dec_values);
+  free_model_stack(&ms);
+
+  RB_GC_GUARD(x_val);
+
+  return y_val;
+}
+
+static VALUE numo_liblinear_predict_ensemble(VALUE self, VALUE x_val, VALUE params_val, VALUE models_val) {
+  return scoreEnsemble(x_val, params_val, models_val, true);
+}
+
+static VALUE numo_liblinear_decision_function_ensemble(VALUE self, VALUE x_val, VALUE params_val, VALUE models_val) {
+  return scoreEnsemble(x_val, params_val, models_val, false);
+}
+
+static VALUE numo_liblinear_quantize(VALUE self, VALUE x_val, VALUE param_hash, VALUE model_hash, VALUE bits_val) {
+  if (CLASS_OF(x_val) != numo_cDFloat) x_val = rb_funcall(numo_cDFloat, rb_intern("cast"), 1, x_val);
+  if (!RTEST(nary_check_contiguous(x_val))) x_val = nary_dup(x_val);
+
+  narray_t* x_nary;
+  GetNArray(x_val, x_nary);
+  if (NA_NDIM(x_nary) != 2) {
+    rb_raise(rb_eArgError, "Expect samples to be 2-D array.");
+    return Qnil;
+  }
+  const int bits = NUM2INT(bits_val);
+  if (bits != 8 && bits != 16) {
+    rb_raise(rb_eArgError, "Expect bits to be 8 or 16.");
+    return Qnil;
+  }
+
+  LibLinearParameter* param = convertHashToLibLinearParameter(param_hash);
+  LibLinearModel* model = convertHashToLibLinearModel(model_hash);
+  model->param = *param;
+
+  struct quantized_model* qm = quantize_model(model, bits);
+
+  const int n_samples = (int)NA_SHAPE(x_nary)[0];
+  const int n_features = (int)NA_SHAPE(x_nary)[1];
+  const double* const x_ptr = (double*)na_get_pointer_for_read(x_val);
+  LibLinearNode** x_nodes = ALLOC_N(LibLinearNode*, n_samples);
+  for (int i = 0; i < n_samples; i++) x_nodes[i] = convertVectorXdToLibLinearNode(&x_ptr[i * n_features], n_features);
+  quantized_max_error(qm, model, x_nodes, n_samples);
+  for (int i = 0; i < n_samples; i++) xfree(x_nodes[i]);
+  xfree(x_nodes);
+
+  VALUE qm_hash = convertQuantizedModelToHash(qm);
+
+  free_quantized_model(&qm);
+  deleteLibLinearModel(model);
+  deleteLibLinearParameter(param);
+
+  RB_GC_GUARD(x_val);
+
+  return qm_hash;
+}
+
+static VALUE numo_liblinear_predict_quantized(VALUE self, VALUE x_val, VALUE qm_hash) {
+  if (CLASS_OF(x_val) != numo_cDFloat) x_val = rb_funcall(numo_cDFloat, rb_intern("cast"), 1, x_val);
+  if (!RTEST(nary_check_contiguous(x_val))) x_val = nary_dup(x_val);
+
+  narray_t* x_nary;
+  GetNArray(x_val, x_nary);
+  if (NA_NDIM(x_nary) != 2) {
+    rb_raise(rb_eArgError, "Expect samples to be 2-D array.");
+    return Qnil;
+  }
+
+  struct quantized_model* qm = convertHashToQuantizedModel(qm_hash);
+  const int n_samples = (int)NA_SHAPE(x_nary)[0];
+  const int n_features = (int)NA_SHAPE(x_nary)[1];
+  if (n_features != qm->nr_feature) {
+    deleteQuantizedModel(qm);
+    rb_raise(rb_eArgError, "Expect samples to have as many features as the model.");
+    return Qnil;
+  }
+
+  size_t y_shape[1] = {(size_t)n_samples};
+  VALUE y_val = rb_narray_new(numo_cDFloat, 1, y_shape);
+  double* y_ptr = (double*)na_get_pointer_for_write(y_val);
+  const double* const x_ptr = (double*)na_get_pointer_for_read(x_val);
+  double* dec_values = ALLOC_N(double, qm->nr_w);
+  for (int i = 0; i < n_samples; i++) y_ptr[i] = predict_quantized_dense(qm, &x_ptr[i * n_features], dec_values);
+
+  xfree(dec_values);
+  deleteQuantizedModel(qm);
+
+  RB_GC_GUARD(x_val);
+
+  return y_val;
+}
+
+static VALUE numo_liblinear_decision_function_quantized(VALUE self, VALUE x_val, VALUE qm_hash) {
+  if (CLASS_OF(x_val) != numo_cDFloat) x_val = rb_funcall(numo_cDFloat, rb_intern("cast"), 1, x_val);
+  if (!RTEST(nary_check_contiguous(x_val))) x_val = nary_dup(x_val);
+
+  narray_t* x_nary;
+  GetNArray(x_val, x_nary);
+  if (NA_NDIM(x_nary) != 2) {
+    rb_raise(rb_eArgError, "Expect samples to be 2-D array.");
+    return Qnil;
+  }
+
+  struct quantized_model* qm = convertHashToQuantizedModel(qm_hash);
+  const int n_samples = (int)NA_SHAPE(x_nary)[0];
+  const int n_features = (int)NA_SHAPE(x_nary)[1];
+  if (n_features != qm->nr_feature) {
+    deleteQuantizedModel(qm);
+    rb_raise(rb_eArgError, "Expect samples to have as many features as the model.");
+    return Qnil;
+  }
+
+  const int y_cols = qm->nr_w;
+  size_t y_shape[2] = {(size_t)n_samples, (size_t)y_cols};
+  const int n_dims = y_cols == 1 ? 1 : 2;
+  VALUE y_val = rb_narray_new(numo_cDFloat, n_dims, y_shape);
+  const double* const x_ptr = (double*)na_get_pointer_for_read(x_val);
+  double* y_ptr = (double*)na_get_pointer_for_write(y_val);
+  for (int i = 0; i < n_samples; i++) predict_quantized_dense(qm, &x_ptr[i * n_features], &y_ptr[i * y_cols]);
+
+  deleteQuantizedModel(qm);
+
+  RB_GC_GUARD(x_val);
+
+  return y_val;
+}
+
 static VALUE numo_liblinear_predict_proba(VALUE self, VALUE x_val, VALUE param_hash, VALUE model_hash) {
   narray_t* x_nary;
   GetNArray(x_val, x_nary);
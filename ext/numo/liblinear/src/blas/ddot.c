@@ -25,13 +25,20 @@ double ddot_(int *n, double *sx, int *incx, double *sy, int *incy)
   {
     if (iincx == 1 && iincy == 1) /* code for both increments equal to 1 */
     {
-      m = nn-4;
-      for (i = 0; i < m; i += 5)
-        stemp += sx[i] * sy[i] + sx[i+1] * sy[i+1] + sx[i+2] * sy[i+2] +
-                 sx[i+3] * sy[i+3] + sx[i+4] * sy[i+4];
+      /* independent partial sums let the compiler vectorize the loop */
+      double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+      m = nn-3;
+      for (i = 0; i < m; i += 4)
+      {
+        s0 += sx[i] * sy[i];
+        s1 += sx[i+1] * sy[i+1];
+        s2 += sx[i+2] * sy[i+2];
+        s3 += sx[i+3] * sy[i+3];
+      }
 
       for ( ; i < nn; i++)        /* clean-up loop */
-        stemp += sx[i] * sy[i];
+        s0 += sx[i] * sy[i];
+      stemp = (s0 + s1) + (s2 + s3);
     }
     else /* code for unequal increments or equal increments not equal to 1 */
     {
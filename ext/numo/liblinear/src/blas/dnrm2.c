@@ -1,3 +1,4 @@
+#include <float.h> /* Needed for DBL_MAX */
 #include <math.h>  /* Needed for fabs() and sqrt() */
 #include "blas.h"
 
@@ -31,6 +32,28 @@ double dnrm2_(int *n, double *x, int *incx)
     }
     else
     {
+      if (iincx == 1)
+      {
+        /* Unscaled sum of squares with independent partial sums, which is
+           vectorized by the compiler. It is used when it can neither
+           overflow nor lose accuracy by underflow; otherwise the scaled
+           loop below is taken. */
+        double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+        long int i, m = nn-3;
+        for (i = 0; i < m; i += 4)
+        {
+          s0 += x[i] * x[i];
+          s1 += x[i+1] * x[i+1];
+          s2 += x[i+2] * x[i+2];
+          s3 += x[i+3] * x[i+3];
+        }
+        for ( ; i < nn; i++)
+          s0 += x[i] * x[i];
+        ssq = (s0 + s1) + (s2 + s3);
+        if (ssq > 1.0e-280 && ssq <= DBL_MAX)
+          return sqrt(ssq);
+      }
+
       scale = 0.0;
       ssq = 1.0;
 
@@ -4,8 +4,15 @@
 #include <string.h>
 #include <stdarg.h>
 #include <locale.h>
+#include <limits.h>
+#include <stdint.h>
+#include <thread>
 #include "linear.h"
 #include "newton.h"
+#include "vmath.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 int liblinear_version = LIBLINEAR_VERSION;
 typedef signed char schar;
 template <class T> static inline void swap(T& x, T& y) { T t=x; x=y; y=t; }
@@ -100,23 +107,106 @@ public:
 			x++;
 		}
 	}
+
+#ifdef _OPENMP
+	// axpy for y shared by threads; each addition is atomic
+	static void axpy_atomic(const double a, const feature_node *x, double *y)
+	{
+		while(x->index != -1)
+		{
+			double v = a*x->value;
+#pragma omp atomic
+			y[x->index-1] += v;
+			x++;
+		}
+	}
+#endif
+};
+
+// Losses of the primal solvers, C_i \xi(y_i, w^Tx_i)
+// They are passed to l2r_erm_fun as template arguments, so the per-sample
+// loops are resolved at compile time and written branch-free to vectorize.
+
+class lr_loss
+{
+public:
+	double C_times_loss(double C_i, double y_i, double wx_i) const
+	{
+		// log(1+exp(-ywx_i)) for ywx_i >= 0, and -ywx_i+log(1+exp(ywx_i)) otherwise
+		double ywx_i = wx_i * y_i;
+		return C_i*(max(-ywx_i, 0.0) + vlog1p(vexp(-fabs(ywx_i))));
+	}
+};
+
+class l2_svc_loss
+{
+public:
+	double C_times_loss(double C_i, double y_i, double wx_i) const
+	{
+		double d = max(1 - y_i * wx_i, 0.0);
+		return C_i * d * d;
+	}
+};
+
+class l2_svr_loss
+{
+public:
+	l2_svr_loss(double p): p(p) {}
+
+	double C_times_loss(double C_i, double y_i, double wx_i) const
+	{
+		double d = max(fabs(wx_i - y_i) - p, 0.0);
+		return C_i * d * d;
+	}
+
+private:
+	double p;
 };
 
+// Sum of C_i \xi(y_i, z_i) with z_i = wx_i, or z_i = d_i*alpha + wx_i if d is given.
+// Losses of a block are stored in a buffer first, so the loop evaluating them
+// is vectorized while the summation keeps its order.
+template <class Loss>
+static double sum_C_times_loss(const Loss& loss, const double *C, const double *y, const double *wx, const double *d, double alpha, int l)
+{
+	const int block_size = 256;
+	double buf[block_size];
+	double sum = 0;
+	for(int start=0; start<l; start+=block_size)
+	{
+		int i, len = min(block_size, l-start);
+		const double *C_b = &C[start], *y_b = &y[start], *wx_b = &wx[start];
+		if(d == NULL)
+			for(i=0;i<len;i++)
+				buf[i] = loss.C_times_loss(C_b[i], y_b[i], wx_b[i]);
+		else
+		{
+			const double *d_b = &d[start];
+			for(i=0;i<len;i++)
+				buf[i] = loss.C_times_loss(C_b[i], y_b[i], d_b[i] * alpha + wx_b[i]);
+		}
+		for(i=0;i<len;i++)
+			sum += buf[i];
+	}
+	return sum;
+}
+
+// Arrays of a training run kept in workspace, following the slots of NEWTON
+enum { WS_WX = workspace::NR_NEWTON_SLOT, WS_TMP, WS_D, WS_I, WS_C, WS_ALPHA, WS_XTX, WS_NEG_INDEX, WS_NEG_X, WS_NEG_Y, WS_NEG_XTX };
+
 // L2-regularized empirical risk minimization
 // min_w w^Tw/2 + \sum C_i \xi(w^Tx_i), where \xi() is the loss
 
 class l2r_erm_fun: public function
 {
 public:
-	l2r_erm_fun(const problem *prob, const parameter *param, double *C);
-	~l2r_erm_fun();
+	l2r_erm_fun(const problem *prob, const parameter *param, double *C, workspace *ws);
 
-	double fun(double *w);
-	double linesearch_and_update(double *w, double *d, double *f, double *g, double alpha);
 	int get_nr_variable(void);
 
 protected:
-	virtual double C_times_loss(int i, double wx_i) = 0;
+	template <class Loss> double erm_fun(const Loss& loss, double *w);
+	template <class Loss> double erm_linesearch_and_update(const Loss& loss, double *w, double *s, double *f, double *g, double alpha);
 	void Xv(double *v, double *Xv);
 	void XTv(double *v, double *XTv);
 
@@ -128,25 +218,21 @@ protected:
 	int regularize_bias;
 };
 
-l2r_erm_fun::l2r_erm_fun(const problem *prob, const parameter *param, double *C)
+l2r_erm_fun::l2r_erm_fun(const problem *prob, const parameter *param, double *C, workspace *ws):
+	function(ws)
 {
 	int l=prob->l;
 
 	this->prob = prob;
 
-	wx = new double[l];
-	tmp = new double[l];
+	wx = ws->get<double>(WS_WX, l);
+	tmp = ws->get<double>(WS_TMP, l);
 	this->C = C;
 	this->regularize_bias = param->regularize_bias;
 }
 
-l2r_erm_fun::~l2r_erm_fun()
-{
-	delete[] wx;
-	delete[] tmp;
-}
-
-double l2r_erm_fun::fun(double *w)
+template <class Loss>
+double l2r_erm_fun::erm_fun(const Loss& loss, double *w)
 {
 	int i;
 	double f=0;
@@ -160,8 +246,7 @@ double l2r_erm_fun::fun(double *w)
 		wTw += w[i]*w[i];
 	if(regularize_bias == 0)
 		wTw -= w[w_size-1]*w[w_size-1];
-	for(i=0;i<l;i++)
-		f += C_times_loss(i, wx[i]);
+	f = sum_C_times_loss(loss, C, prob->y, wx, NULL, 0, l);
 	f = f + 0.5 * wTw;
 
 	return f;
@@ -174,7 +259,8 @@ int l2r_erm_fun::get_nr_variable(void)
 
 // On entry *f must be the function value of w
 // On exit w is updated and *f is the new function value
-double l2r_erm_fun::linesearch_and_update(double *w, double *s, double *f, double *g, double alpha)
+template <class Loss>
+double l2r_erm_fun::erm_linesearch_and_update(const Loss& loss, double *w, double *s, double *f, double *g, double alpha)
 {
 	int i;
 	int l = prob->l;
@@ -203,13 +289,8 @@ double l2r_erm_fun::linesearch_and_update(double *w, double *s, double *f, doubl
 	int num_linesearch = 0;
 	for(num_linesearch=0; num_linesearch < max_num_linesearch; num_linesearch++)
 	{
-		double loss = 0;
-		for(i=0;i<l;i++)
-		{
-			double inner_product = tmp[i] * alpha + wx[i];
-			loss += C_times_loss(i, inner_product);
-		}
-		*f = loss + (alpha * alpha * sTs + wTw) / 2.0 + alpha * wTs;
+		double loss_sum = sum_C_times_loss(loss, C, prob->y, wx, tmp, alpha, l);
+		*f = loss_sum + (alpha * alpha * sTs + wTw) / 2.0 + alpha * wTs;
 		if (*f - fold <= eta * alpha * gTs)
 		{
 			for (i=0;i<l;i++)
@@ -220,6 +301,8 @@ double l2r_erm_fun::linesearch_and_update(double *w, double *s, double *f, doubl
 			alpha *= 0.5;
 	}
 
+	if (ws->stat)
+		ws->stat->nr_linesearch += num_linesearch;
 	if (num_linesearch >= max_num_linesearch)
 	{
 		*f = fold;
@@ -238,9 +321,13 @@ void l2r_erm_fun::Xv(double *v, double *Xv)
 	int i;
 	int l=prob->l;
 	feature_node **x=prob->x;
+	double t = ws->stat ? workspace::now() : 0;
 
 	for(i=0;i<l;i++)
 		Xv[i]=sparse_operator::dot(v, x[i]);
+
+	if(ws->stat)
+		ws->stat->time_Xv += workspace::now() - t;
 }
 
 void l2r_erm_fun::XTv(double *v, double *XTv)
@@ -249,19 +336,27 @@ void l2r_erm_fun::XTv(double *v, double *XTv)
 	int l=prob->l;
 	int w_size=get_nr_variable();
 	feature_node **x=prob->x;
+	double t = ws->stat ? workspace::now() : 0;
 
 	for(i=0;i<w_size;i++)
 		XTv[i]=0;
 	for(i=0;i<l;i++)
 		sparse_operator::axpy(v[i], x[i], XTv);
+
+	if(ws->stat)
+		ws->stat->time_XTv += workspace::now() - t;
 }
 
 class l2r_lr_fun: public l2r_erm_fun
 {
 public:
-	l2r_lr_fun(const problem *prob, const parameter *param, double *C);
-	~l2r_lr_fun();
+	l2r_lr_fun(const problem *prob, const parameter *param, double *C, workspace *ws);
 
+	double fun(double *w) { return erm_fun(lr_loss(), w); }
+	double linesearch_and_update(double *w, double *s, double *f, double *g, double alpha)
+	{
+		return erm_linesearch_and_update(lr_loss(), w, s, f, g, alpha);
+	}
 	void grad(double *w, double *g);
 	void Hv(double *s, double *Hs);
 
@@ -269,28 +364,13 @@ public:
 
 private:
 	double *D;
-	double C_times_loss(int i, double wx_i);
 };
 
-l2r_lr_fun::l2r_lr_fun(const problem *prob, const parameter *param, double *C):
-	l2r_erm_fun(prob, param, C)
+l2r_lr_fun::l2r_lr_fun(const problem *prob, const parameter *param, double *C, workspace *ws):
+	l2r_erm_fun(prob, param, C, ws)
 {
 	int l=prob->l;
-	D = new double[l];
-}
-
-l2r_lr_fun::~l2r_lr_fun()
-{
-	delete[] D;
-}
-
-double l2r_lr_fun::C_times_loss(int i, double wx_i)
-{
-	double ywx_i = wx_i * prob->y[i];
-	if (ywx_i >= 0)
-		return C[i]*log(1 + exp(-ywx_i));
-	else
-		return C[i]*(-ywx_i + log(1 + exp(ywx_i)));
+	D = ws->get<double>(WS_D, l);
 }
 
 void l2r_lr_fun::grad(double *w, double *g)
@@ -302,7 +382,7 @@ void l2r_lr_fun::grad(double *w, double *g)
 
 	for(i=0;i<l;i++)
 	{
-		tmp[i] = 1/(1 + exp(-y[i]*wx[i]));
+		tmp[i] = 1/(1 + vexp(-y[i]*wx[i]));
 		D[i] = tmp[i]*(1-tmp[i]);
 		tmp[i] = C[i]*(tmp[i]-1)*y[i];
 	}
@@ -364,9 +444,13 @@ void l2r_lr_fun::Hv(double *s, double *Hs)
 class l2r_l2_svc_fun: public l2r_erm_fun
 {
 public:
-	l2r_l2_svc_fun(const problem *prob, const parameter *param, double *C);
-	~l2r_l2_svc_fun();
+	l2r_l2_svc_fun(const problem *prob, const parameter *param, double *C, workspace *ws);
 
+	double fun(double *w) { return erm_fun(l2_svc_loss(), w); }
+	double linesearch_and_update(double *w, double *s, double *f, double *g, double alpha)
+	{
+		return erm_linesearch_and_update(l2_svc_loss(), w, s, f, g, alpha);
+	}
 	void grad(double *w, double *g);
 	void Hv(double *s, double *Hs);
 
@@ -377,29 +461,12 @@ protected:
 
 	int *I;
 	int sizeI;
-
-private:
-	double C_times_loss(int i, double wx_i);
 };
 
-l2r_l2_svc_fun::l2r_l2_svc_fun(const problem *prob, const parameter *param, double *C):
-	l2r_erm_fun(prob, param, C)
+l2r_l2_svc_fun::l2r_l2_svc_fun(const problem *prob, const parameter *param, double *C, workspace *ws):
+	l2r_erm_fun(prob, param, C, ws)
 {
-	I = new int[prob->l];
-}
-
-l2r_l2_svc_fun::~l2r_l2_svc_fun()
-{
-	delete[] I;
-}
-
-double l2r_l2_svc_fun::C_times_loss(int i, double wx_i)
-{
-	double d = 1 - prob->y[i] * wx_i;
-	if (d > 0)
-		return C[i] * d * d;
-	else
-		return 0;
+	I = ws->get<int>(WS_I, prob->l);
 }
 
 void l2r_l2_svc_fun::grad(double *w, double *g)
@@ -479,42 +546,40 @@ void l2r_l2_svc_fun::subXTv(double *v, double *XTv)
 	int i;
 	int w_size=get_nr_variable();
 	feature_node **x=prob->x;
+	double t = ws->stat ? workspace::now() : 0;
 
 	for(i=0;i<w_size;i++)
 		XTv[i]=0;
 	for(i=0;i<sizeI;i++)
 		sparse_operator::axpy(v[i], x[I[i]], XTv);
+
+	if(ws->stat)
+		ws->stat->time_XTv += workspace::now() - t;
 }
 
 class l2r_l2_svr_fun: public l2r_l2_svc_fun
 {
 public:
-	l2r_l2_svr_fun(const problem *prob, const parameter *param, double *C);
+	l2r_l2_svr_fun(const problem *prob, const parameter *param, double *C, workspace *ws);
 
+	double fun(double *w) { return erm_fun(l2_svr_loss(p), w); }
+	double linesearch_and_update(double *w, double *s, double *f, double *g, double alpha)
+	{
+		return erm_linesearch_and_update(l2_svr_loss(p), w, s, f, g, alpha);
+	}
 	void grad(double *w, double *g);
 
 private:
-	double C_times_loss(int i, double wx_i);
 	double p;
 };
 
-l2r_l2_svr_fun::l2r_l2_svr_fun(const problem *prob, const parameter *param, double *C):
-	l2r_l2_svc_fun(prob, param, C)
+l2r_l2_svr_fun::l2r_l2_svr_fun(const problem *prob, const parameter *param, double *C, workspace *ws):
+	l2r_l2_svc_fun(prob, param, C, ws)
 {
 	this->p = param->p;
 	this->regularize_bias = param->regularize_bias;
 }
 
-double l2r_l2_svr_fun::C_times_loss(int i, double wx_i)
-{
-	double d = wx_i - prob->y[i];
-	if(d < -p)
-		return C[i]*(d+p)*(d+p);
-	else if(d > p)
-		return C[i]*(d-p)*(d-p);
-	return 0;
-}
-
 void l2r_l2_svr_fun::grad(double *w, double *g)
 {
 	int i;
@@ -551,6 +616,45 @@ void l2r_l2_svr_fun::grad(double *w, double *g)
 		g[w_size-1] -= w[w_size-1];
 }
 
+// Bytes of the arrays a solver allocates itself on l rows and n columns,
+// besides the slots of the workspace; nr_class is used by MCSVM_CS only.
+// The solvers count them in the workspace, and estimate_train_memory adds
+// them to its estimate.
+static size_t solver_bytes(int solver_type, int l, int n, int nr_class, int nr_thread)
+{
+	size_t L = (size_t)l, N = (size_t)n, K = (size_t)nr_class;
+	size_t shrunk = 0;	// the flags of shrinking of the parallel solvers
+#ifdef _OPENMP
+	if(nr_thread > 1)
+		shrunk = sizeof(schar);
+#endif
+	switch(solver_type)
+	{
+		case L2R_L2LOSS_SVC_DUAL:
+		case L2R_L1LOSS_SVC_DUAL:
+			return L*(sizeof(double)+sizeof(int)+sizeof(schar)+shrunk);
+		case L2R_L2LOSS_SVR_DUAL:
+		case L2R_L1LOSS_SVR_DUAL:
+			return L*(sizeof(double)+sizeof(int)+shrunk);
+		case L2R_LR_DUAL:
+			return L*(3*sizeof(double)+sizeof(int)+sizeof(schar));
+		case L1R_L2LOSS_SVC:
+			return N*(sizeof(double)+sizeof(int)+shrunk) + L*(sizeof(double)+sizeof(schar));
+		case L1R_LR:
+			return N*(4*sizeof(double)+sizeof(int)+shrunk) + L*(5*sizeof(double)+sizeof(schar));
+		case MCSVM_CS:
+			// the lists of dual variables grow in the solver, which counts them
+			return L*(sizeof(double)+4*sizeof(int)+sizeof(int *)+sizeof(double *)) + K*(6*sizeof(double)+2*sizeof(int));
+		case ONECLASS_SVM:
+			// with threads, the merged pairs and the counts of each thread
+			return L*(3*sizeof(double)+sizeof(int)+2*sizeof(feature_node)+shrunk)
+				+ (shrunk > 0 ? 2*(L/10+1)*sizeof(feature_node) + 4*(size_t)nr_thread*sizeof(int) : 0);
+		default:
+			// the Newton method works in the slots
+			return 0;
+	}
+}
+
 // A coordinate descent algorithm for
 // multi-class support vector machines by Crammer and Singer
 //
@@ -579,11 +683,17 @@ class Solver_MCSVM_CS
 	public:
 		Solver_MCSVM_CS(const problem *prob, int nr_class, double *C, double eps=0.1, int max_iter=100000);
 		~Solver_MCSVM_CS();
-		void Solve(double *w);
+		void Solve(double *w, workspace *ws);
 	private:
 		void solve_sub_problem(double A_i, int yi, double C_yi, int active_i, double *alpha_new);
 		bool be_shrunk(int i, int m, int yi, double alpha_i, double minG);
-		double *B, *C, *G;
+		void store_alpha(int i, const double *alpha_i, const int *alpha_index_i, int active_size_i, int y_index, workspace *ws);
+		double *B, *C, *G, *D;
+		// the dual variables of sample i: alpha_value[i][k] of class
+		// alpha_class[i][k] for k < nr_listed[i], in arrays of max_listed[i]
+		int **alpha_class;
+		double **alpha_value;
+		int *nr_listed, *max_listed;
 		int w_size, l;
 		int nr_class;
 		int max_iter;
@@ -601,6 +711,7 @@ Solver_MCSVM_CS::Solver_MCSVM_CS(const problem *prob, int nr_class, double *weig
 	this->prob = prob;
 	this->B = new double[nr_class];
 	this->G = new double[nr_class];
+	this->D = new double[nr_class];
 	this->C = weighted_C;
 }
 
@@ -608,31 +719,74 @@ Solver_MCSVM_CS::~Solver_MCSVM_CS()
 {
 	delete[] B;
 	delete[] G;
+	delete[] D;
 }
 
-int compare_double(const void *a, const void *b)
+// The subproblem of sample i is solved by finding beta, the threshold with
+//
+//   beta = (\sum_{m: D_m > beta} D_m - A_i*C_yi) / |{m: D_m > beta}|
+//
+// where D = B, with A_i*C_yi added to D_yi. Instead of sorting D, the set
+// {m: D_m > beta} is found by selection: a pivot of the candidates splits
+// them into those above, equal to and below it, and the test for the
+// pivot decides which side is left to search. This takes O(active_i)
+// expected time. D[0:active_i] is permuted; AC_yi is A_i*C_yi.
+static double sub_problem_threshold(double *D, int active_i, double AC_yi)
 {
-	if(*(double *)a > *(double *)b)
-		return -1;
-	if(*(double *)a < *(double *)b)
-		return 1;
-	return 0;
+	// D[0:lo] are above beta, D[hi:active_i] are not, and D[lo:hi] are
+	// the candidates; sum is of D[0:lo] minus AC_yi
+	double sum = -AC_yi;
+	int lo = 0, hi = active_i;
+	while(lo < hi)
+	{
+		// median of three candidates as the pivot
+		double a = D[lo], b = D[lo+(hi-lo)/2], c = D[hi-1];
+		double pivot = max(min(a, b), min(max(a, b), c));
+
+		// D[lo:gt] > pivot, D[gt:lt] == pivot, D[lt:hi] < pivot
+		int gt = lo, lt = hi, k = lo;
+		double sum_gt = 0;
+		while(k < lt)
+		{
+			if(D[k] > pivot)
+			{
+				sum_gt += D[k];
+				swap(D[k++], D[gt++]);
+			}
+			else if(D[k] < pivot)
+				swap(D[k], D[--lt]);
+			else
+				k++;
+		}
+
+		// the values equal to the pivot are above beta with the larger ones,
+		// or none of them is
+		if(sum + sum_gt < gt*pivot)
+		{
+			sum += sum_gt + (lt-gt)*pivot;
+			lo = lt;
+		}
+		else
+			hi = gt;
+	}
+	if(lo > 0)
+		return sum/lo;
+
+	// only if AC_yi is 0; the largest D alone gives beta
+	double beta = D[0];
+	for(int r=1;r<active_i;r++)
+		beta = max(beta, D[r]);
+	return beta - AC_yi;
 }
 
 void Solver_MCSVM_CS::solve_sub_problem(double A_i, int yi, double C_yi, int active_i, double *alpha_new)
 {
 	int r;
-	double *D;
-
-	clone(D, B, active_i);
+	for(r=0;r<active_i;r++)
+		D[r] = B[r];
 	if(yi < active_i)
 		D[yi] += A_i*C_yi;
-	qsort(D, active_i, sizeof(double), compare_double);
-
-	double beta = D[0] - A_i*C_yi;
-	for(r=1;r<active_i && beta<r*D[r];r++)
-		beta += D[r];
-	beta /= r;
+	double beta = sub_problem_threshold(D, active_i, A_i*C_yi);
 
 	for(r=0;r<active_i;r++)
 	{
@@ -641,7 +795,6 @@ void Solver_MCSVM_CS::solve_sub_problem(double A_i, int yi, double C_yi, int act
 		else
 			alpha_new[r] = min((double)0, (beta - B[r])/A_i);
 	}
-	delete[] D;
 }
 
 bool Solver_MCSVM_CS::be_shrunk(int i, int m, int yi, double alpha_i, double minG)
@@ -654,20 +807,84 @@ bool Solver_MCSVM_CS::be_shrunk(int i, int m, int yi, double alpha_i, double min
 	return false;
 }
 
-void Solver_MCSVM_CS::Solve(double *w)
+// Sets the list of the dual variables of sample i from alpha_i and
+// alpha_index_i, where y_i is at y_index: while all classes are active, the classes of nonzero
+// alpha; otherwise the active classes, followed by y_i if it is shrunk
+// with a nonzero alpha (at its bound C). The other alpha are 0.
+void Solver_MCSVM_CS::store_alpha(int i, const double *alpha_i, const int *alpha_index_i, int active_size_i, int y_index, workspace *ws)
+{
+	int m, yi = (int)prob->y[i];
+	int nr = 0;
+	if(active_size_i == nr_class)
+	{
+		for(m=0;m<nr_class;m++)
+			if(alpha_i[m] != 0)
+				nr++;
+	}
+	else
+	{
+		nr = active_size_i;
+		if(y_index >= active_size_i && alpha_i[yi] != 0)
+			nr++;
+	}
+
+	if(nr > max_listed[i])
+	{
+		int max_nr = max(nr, min(2*max_listed[i], nr_class));
+		ws->mem_alloc((size_t)(max_nr-max_listed[i])*(sizeof(int)+sizeof(double)));
+		alpha_class[i] = (int *)realloc(alpha_class[i], max_nr*sizeof(int));
+		alpha_value[i] = (double *)realloc(alpha_value[i], max_nr*sizeof(double));
+		max_listed[i] = max_nr;
+	}
+
+	int *class_i = alpha_class[i];
+	double *value_i = alpha_value[i];
+	if(active_size_i == nr_class)
+	{
+		nr = 0;
+		for(m=0;m<nr_class;m++)
+			if(alpha_i[m] != 0)
+			{
+				class_i[nr] = m;
+				value_i[nr++] = alpha_i[m];
+			}
+	}
+	else
+	{
+		for(m=0;m<active_size_i;m++)
+		{
+			class_i[m] = alpha_index_i[m];
+			value_i[m] = alpha_i[alpha_index_i[m]];
+		}
+		if(nr > active_size_i)
+		{
+			class_i[m] = yi;
+			value_i[m] = alpha_i[yi];
+		}
+	}
+	nr_listed[i] = nr;
+}
+
+void Solver_MCSVM_CS::Solve(double *w, workspace *ws)
 {
 	int i, m, s;
 	int iter = 0;
-	double *alpha = new double[l*nr_class];
+	// the alpha of the sample being updated, by class; 0 out of its list
+	double *alpha_i = new double[nr_class];
+	int *alpha_index_i = new int[nr_class];
 	double *alpha_new = new double[nr_class];
 	int *index = new int[l];
 	double *QD = new double[l];
 	int *d_ind = new int[nr_class];
 	double *d_val = new double[nr_class];
-	int *alpha_index = new int[nr_class*l];
-	int *y_index = new int[l];
 	int active_size = l;
 	int *active_size_i = new int[l];
+	alpha_class = new int*[l];
+	alpha_value = new double*[l];
+	nr_listed = new int[l];
+	max_listed = new int[l];
+	size_t mem = solver_bytes(MCSVM_CS, l, w_size, nr_class, 1);
+	ws->mem_alloc(mem);
 	double eps_shrink = max(10.0*eps, 1.0); // stopping tolerance for shrinking
 	bool start_from_all = true;
 
@@ -675,30 +892,30 @@ void Solver_MCSVM_CS::Solve(double *w)
 	// sum_m alpha[i*nr_class+m] = 0, for all i=1,...,l-1
 	// alpha[i*nr_class+m] <= C[GETI(i)] if prob->y[i] == m
 	// alpha[i*nr_class+m] <= 0 if prob->y[i] != m
-	// If initial alpha isn't zero, uncomment the for loop below to initialize w
-	for(i=0;i<l*nr_class;i++)
-		alpha[i] = 0;
+	// If initial alpha isn't zero, list it in alpha_class and alpha_value,
+	// and uncomment the for loop below to initialize w
+	for(m=0;m<nr_class;m++)
+		alpha_i[m] = 0;
 
 	for(i=0;i<w_size*nr_class;i++)
 		w[i] = 0;
 	for(i=0;i<l;i++)
 	{
-		for(m=0;m<nr_class;m++)
-			alpha_index[i*nr_class+m] = m;
+		alpha_class[i] = NULL;
+		alpha_value[i] = NULL;
+		nr_listed[i] = 0;
+		max_listed[i] = 0;
 		feature_node *xi = prob->x[i];
-		QD[i] = 0;
-		while(xi->index != -1)
-		{
-			double val = xi->value;
-			QD[i] += val*val;
-
-			// Uncomment the for loop if initial alpha isn't zero
-			// for(m=0; m<nr_class; m++)
-			//	w[(xi->index-1)*nr_class+m] += alpha[i*nr_class+m]*val;
-			xi++;
-		}
+		QD[i] = ws->xTx != NULL ? ws->xTx[i] : sparse_operator::nrm2_sq(xi);
+
+		// Uncomment the for loop if initial alpha isn't zero
+		// while(xi->index != -1)
+		// {
+		//	for(m=0; m<nr_listed[i]; m++)
+		//		w[(xi->index-1)*nr_class+alpha_class[i][m]] += alpha_value[i][m]*xi->value;
+		//	xi++;
+		// }
 		active_size_i[i] = nr_class;
-		y_index[i] = (int)prob->y[i];
 		index[i] = i;
 	}
 
@@ -714,15 +931,35 @@ void Solver_MCSVM_CS::Solve(double *w)
 		{
 			i = index[s];
 			double Ai = QD[i];
-			double *alpha_i = &alpha[i*nr_class];
-			int *alpha_index_i = &alpha_index[i*nr_class];
 
 			if(Ai > 0)
 			{
+				// the classes in order: all, or the listed ones once some
+				// are shrunk; y_index is the position of y_i
+				int yi = (int)prob->y[i];
+				int y_index = yi;
+				int nr_index = nr_class;
+				if(active_size_i[i] == nr_class)
+					for(m=0;m<nr_class;m++)
+						alpha_index_i[m] = m;
+				else
+				{
+					nr_index = nr_listed[i];
+					y_index = nr_index;
+					for(m=0;m<nr_index;m++)
+					{
+						alpha_index_i[m] = alpha_class[i][m];
+						if(alpha_index_i[m] == yi)
+							y_index = m;
+					}
+				}
+				for(m=0;m<nr_listed[i];m++)
+					alpha_i[alpha_class[i][m]] = alpha_value[i][m];
+
 				for(m=0;m<active_size_i[i];m++)
 					G[m] = 1;
-				if(y_index[i] < active_size_i[i])
-					G[y_index[i]] = 0;
+				if(y_index < active_size_i[i])
+					G[y_index] = 0;
 
 				feature_node *xi = prob->x[i];
 				while(xi->index!= -1)
@@ -742,26 +979,26 @@ void Solver_MCSVM_CS::Solve(double *w)
 					if(G[m] > maxG)
 						maxG = G[m];
 				}
-				if(y_index[i] < active_size_i[i])
-					if(alpha_i[(int) prob->y[i]] < C[GETI(i)] && G[y_index[i]] < minG)
-						minG = G[y_index[i]];
+				if(y_index < active_size_i[i])
+					if(alpha_i[yi] < C[GETI(i)] && G[y_index] < minG)
+						minG = G[y_index];
 
 				for(m=0;m<active_size_i[i];m++)
 				{
-					if(be_shrunk(i, m, y_index[i], alpha_i[alpha_index_i[m]], minG))
+					if(be_shrunk(i, m, y_index, alpha_i[alpha_index_i[m]], minG))
 					{
 						active_size_i[i]--;
 						while(active_size_i[i]>m)
 						{
-							if(!be_shrunk(i, active_size_i[i], y_index[i],
+							if(!be_shrunk(i, active_size_i[i], y_index,
 											alpha_i[alpha_index_i[active_size_i[i]]], minG))
 							{
 								swap(alpha_index_i[m], alpha_index_i[active_size_i[i]]);
 								swap(G[m], G[active_size_i[i]]);
-								if(y_index[i] == active_size_i[i])
-									y_index[i] = m;
-								else if(y_index[i] == m)
-									y_index[i] = active_size_i[i];
+								if(y_index == active_size_i[i])
+									y_index = m;
+								else if(y_index == m)
+									y_index = active_size_i[i];
 								break;
 							}
 							active_size_i[i]--;
@@ -774,39 +1011,41 @@ void Solver_MCSVM_CS::Solve(double *w)
 					active_size--;
 					swap(index[s], index[active_size]);
 					s--;
-					continue;
 				}
-
-				if(maxG-minG <= 1e-12)
-					continue;
-				else
+				else if(maxG-minG > 1e-12)
+				{
 					stopping = max(maxG - minG, stopping);
 
-				for(m=0;m<active_size_i[i];m++)
-					B[m] = G[m] - Ai*alpha_i[alpha_index_i[m]] ;
+					for(m=0;m<active_size_i[i];m++)
+						B[m] = G[m] - Ai*alpha_i[alpha_index_i[m]] ;
 
-				solve_sub_problem(Ai, y_index[i], C[GETI(i)], active_size_i[i], alpha_new);
-				int nz_d = 0;
-				for(m=0;m<active_size_i[i];m++)
-				{
-					double d = alpha_new[m] - alpha_i[alpha_index_i[m]];
-					alpha_i[alpha_index_i[m]] = alpha_new[m];
-					if(fabs(d) >= 1e-12)
+					solve_sub_problem(Ai, y_index, C[GETI(i)], active_size_i[i], alpha_new);
+					int nz_d = 0;
+					for(m=0;m<active_size_i[i];m++)
 					{
-						d_ind[nz_d] = alpha_index_i[m];
-						d_val[nz_d] = d;
-						nz_d++;
+						double d = alpha_new[m] - alpha_i[alpha_index_i[m]];
+						alpha_i[alpha_index_i[m]] = alpha_new[m];
+						if(fabs(d) >= 1e-12)
+						{
+							d_ind[nz_d] = alpha_index_i[m];
+							d_val[nz_d] = d;
+							nz_d++;
+						}
 					}
-				}
 
-				xi = prob->x[i];
-				while(xi->index != -1)
-				{
-					double *w_i = &w[(xi->index-1)*nr_class];
-					for(m=0;m<nz_d;m++)
-						w_i[d_ind[m]] += d_val[m]*xi->value;
-					xi++;
+					xi = prob->x[i];
+					while(xi->index != -1)
+					{
+						double *w_i = &w[(xi->index-1)*nr_class];
+						for(m=0;m<nz_d;m++)
+							w_i[d_ind[m]] += d_val[m]*xi->value;
+						xi++;
+					}
 				}
+
+				store_alpha(i, alpha_i, alpha_index_i, active_size_i[i], y_index, ws);
+				for(m=0;m<nr_index;m++)
+					alpha_i[alpha_index_i[m]] = 0;
 			}
 		}
 
@@ -815,6 +1054,7 @@ void Solver_MCSVM_CS::Solve(double *w)
 		{
 			info(".");
 		}
+		ws->add_iter(iter, NAN, stopping, active_size);
 
 		if(stopping < eps_shrink)
 		{
@@ -824,7 +1064,20 @@ void Solver_MCSVM_CS::Solve(double *w)
 			{
 				active_size = l;
 				for(i=0;i<l;i++)
+				{
+					if(active_size_i[i] == nr_class)
+						continue;
+					// only the nonzero alpha stay listed
+					int nr = 0;
+					for(m=0;m<nr_listed[i];m++)
+						if(alpha_value[i][m] != 0)
+						{
+							alpha_class[i][nr] = alpha_class[i][m];
+							alpha_value[i][nr++] = alpha_value[i][m];
+						}
+					nr_listed[i] = nr;
 					active_size_i[i] = nr_class;
+				}
 				info("*");
 				eps_shrink = max(eps_shrink/2, eps);
 				start_from_all = true;
@@ -832,6 +1085,9 @@ void Solver_MCSVM_CS::Solve(double *w)
 		}
 		else
 			start_from_all = false;
+
+		if(ws->time_is_up())
+			break;
 	}
 
 	info("\noptimization finished, #iter = %d\n",iter);
@@ -844,26 +1100,37 @@ void Solver_MCSVM_CS::Solve(double *w)
 	for(i=0;i<w_size*nr_class;i++)
 		v += w[i]*w[i];
 	v = 0.5*v;
-	for(i=0;i<l*nr_class;i++)
+	size_t listed_bytes = 0;
+	for(i=0;i<l;i++)
 	{
-		v += alpha[i];
-		if(fabs(alpha[i]) > 0)
-			nSV++;
+		for(m=0;m<nr_listed[i];m++)
+		{
+			v += alpha_value[i][m];
+			if(alpha_class[i][m] == (int)prob->y[i])
+				v -= alpha_value[i][m];
+			if(fabs(alpha_value[i][m]) > 0)
+				nSV++;
+		}
+		listed_bytes += (size_t)max_listed[i]*(sizeof(int)+sizeof(double));
+		free(alpha_class[i]);
+		free(alpha_value[i]);
 	}
-	for(i=0;i<l;i++)
-		v -= alpha[i*nr_class+(int)prob->y[i]];
 	info("Objective value = %lf\n",v);
 	info("nSV = %d\n",nSV);
 
-	delete [] alpha;
+	delete [] alpha_i;
+	delete [] alpha_index_i;
 	delete [] alpha_new;
 	delete [] index;
 	delete [] QD;
 	delete [] d_ind;
 	delete [] d_val;
-	delete [] alpha_index;
-	delete [] y_index;
 	delete [] active_size_i;
+	delete [] alpha_class;
+	delete [] alpha_value;
+	delete [] nr_listed;
+	delete [] max_listed;
+	ws->mem_free(mem + listed_bytes);
 }
 
 // A coordinate descent algorithm for
@@ -888,17 +1155,26 @@ void Solver_MCSVM_CS::Solve(double *w)
 // x, y, Cp, Cn
 // eps is the stopping tolerance
 //
-// solution will be put in w
+// alpha holds the initial dual variables on entry
+// w_rest, if not NULL, is the part of w of rows outside prob: w starts
+// from it instead of 0, so prob can be a block of a larger problem
+// solution will be put in w, and the dual solution in alpha
 //
 // this function returns the number of iterations
 //
 // See Algorithm 3 of Hsieh et al., ICML 2008
+//
+// With param->nr_thread > 1, each sweep is run by threads in the way of
+// PASSCoDe-Atomic (Hsieh et al., ICML 2015): the threads update disjoint
+// coordinates of the shuffled index against the shared w with atomic
+// additions, coordinates to be shrunk are removed after the sweep, and w
+// is recomputed from alpha at the end.
 
 #undef GETI
 #define GETI(i) (y[i]+1)
 // To support weights for instances, use GETI(i) (i)
 
-static int solve_l2r_l1l2_svc(const problem *prob, const parameter *param, double *w, double Cp, double Cn, int max_iter=300)
+static int solve_l2r_l1l2_svc(const problem *prob, const parameter *param, double *w, double *alpha, double Cp, double Cn, workspace *ws, int max_iter=300, const double *w_rest=NULL)
 {
 	int l = prob->l;
 	int w_size = prob->n;
@@ -908,9 +1184,16 @@ static int solve_l2r_l1l2_svc(const problem *prob, const parameter *param, doubl
 	double C, d, G;
 	double *QD = new double[l];
 	int *index = new int[l];
-	double *alpha = new double[l];
 	schar *y = new schar[l];
 	int active_size = l;
+	schar *shrunk = NULL;
+#ifdef _OPENMP
+	int nr_thread = param->nr_thread;
+	if(nr_thread > 1)
+		shrunk = new schar[l];
+#endif
+	size_t mem = solver_bytes(param->solver_type, l, w_size, 0, param->nr_thread);
+	ws->mem_alloc(mem);
 
 	// PG: projected gradient, for shrinking and stopping
 	double PG;
@@ -941,20 +1224,21 @@ static int solve_l2r_l1l2_svc(const problem *prob, const parameter *param, doubl
 		}
 	}
 
-	// Initial alpha can be set here. Note that
+	// The initial alpha is clipped to
 	// 0 <= alpha[i] <= upper_bound[GETI(i)]
 	for(i=0; i<l; i++)
-		alpha[i] = 0;
+		alpha[i] = min(max(alpha[i], 0.0), upper_bound[GETI(i)]);
 
 	for(i=0; i<w_size; i++)
-		w[i] = 0;
+		w[i] = w_rest != NULL ? w_rest[i] : 0;
 	for(i=0; i<l; i++)
 	{
 		QD[i] = diag[GETI(i)];
 
 		feature_node * const xi = prob->x[i];
-		QD[i] += sparse_operator::nrm2_sq(xi);
-		sparse_operator::axpy(y[i]*alpha[i], xi, w);
+		QD[i] += ws->xTx != NULL ? ws->xTx[i] : sparse_operator::nrm2_sq(xi);
+		if(alpha[i] != 0)
+			sparse_operator::axpy(y[i]*alpha[i], xi, w);
 
 		index[i] = i;
 	}
@@ -970,6 +1254,68 @@ static int solve_l2r_l1l2_svc(const problem *prob, const parameter *param, doubl
 			swap(index[i], index[j]);
 		}
 
+#ifdef _OPENMP
+		if(nr_thread > 1)
+		{
+#pragma omp parallel num_threads(nr_thread)
+			{
+				double PGmax_thread = -INF;
+				double PGmin_thread = INF;
+#pragma omp for schedule(static)
+				for (int k=0; k<active_size; k++)
+				{
+					int ik = index[k];
+					const schar yi = y[ik];
+					feature_node * const xi = prob->x[ik];
+					double Ck = upper_bound[GETI(ik)];
+					double Gk = yi*sparse_operator::dot(w, xi)-1 + alpha[ik]*diag[GETI(ik)];
+					double PGk = 0;
+
+					shrunk[k] = 0;
+					if (alpha[ik] == 0)
+					{
+						if (Gk > PGmax_old)
+							shrunk[k] = 1;
+						else if (Gk < 0)
+							PGk = Gk;
+					}
+					else if (alpha[ik] == Ck)
+					{
+						if (Gk < PGmin_old)
+							shrunk[k] = 1;
+						else if (Gk > 0)
+							PGk = Gk;
+					}
+					else
+						PGk = Gk;
+					if (shrunk[k])
+						continue;
+
+					PGmax_thread = max(PGmax_thread, PGk);
+					PGmin_thread = min(PGmin_thread, PGk);
+
+					if(fabs(PGk) > 1.0e-12)
+					{
+						double alpha_old = alpha[ik];
+						alpha[ik] = min(max(alpha[ik] - Gk/QD[ik], 0.0), Ck);
+						sparse_operator::axpy_atomic((alpha[ik] - alpha_old)*yi, xi, w);
+					}
+				}
+#pragma omp critical
+				{
+					PGmax_new = max(PGmax_new, PGmax_thread);
+					PGmin_new = min(PGmin_new, PGmin_thread);
+				}
+			}
+
+			int new_active_size = 0;
+			for (s=0; s<active_size; s++)
+				if (!shrunk[s])
+					swap(index[new_active_size++], index[s]);
+			active_size = new_active_size;
+		}
+		else
+#endif
 		for (s=0; s<active_size; s++)
 		{
 			i = index[s];
@@ -1024,6 +1370,7 @@ static int solve_l2r_l1l2_svc(const problem *prob, const parameter *param, doubl
 		iter++;
 		if(iter % 10 == 0)
 			info(".");
+		ws->add_iter(iter, NAN, PGmax_new - PGmin_new, active_size);
 
 		if(PGmax_new - PGmin_new <= eps &&
 			fabs(PGmax_new) <= eps && fabs(PGmin_new) <= eps)
@@ -1045,6 +1392,9 @@ static int solve_l2r_l1l2_svc(const problem *prob, const parameter *param, doubl
 			PGmax_old = INF;
 		if (PGmin_old >= 0)
 			PGmin_old = -INF;
+
+		if(ws->time_is_up())
+			break;
 	}
 
 	info("\noptimization finished, #iter = %d\n",iter);
@@ -1067,10 +1417,11 @@ static int solve_l2r_l1l2_svc(const problem *prob, const parameter *param, doubl
 	// Reconstruct w from the primal-dual relationship w=sum(\alpha_i y_i x_i)
 	// This may reduce the weight density. Some zero weights become non-zeros
 	// due to the numerical update w <- w + (alpha[i] - alpha_old) y_i x_i.
-	if (param->w_recalc)
+	// The asynchronous updates of threads always need it.
+	if (param->w_recalc || shrunk != NULL)
 	{
 		for(i=0; i<w_size; i++)
-			w[i] = 0;
+			w[i] = w_rest != NULL ? w_rest[i] : 0;
 		for(i=0; i<l; i++)
 		{
 			feature_node * const xi = prob->x[i];
@@ -1080,9 +1431,10 @@ static int solve_l2r_l1l2_svc(const problem *prob, const parameter *param, doubl
 	}
 
 	delete [] QD;
-	delete [] alpha;
 	delete [] y;
 	delete [] index;
+	delete [] shrunk;
+	ws->mem_free(mem);
 
 	return iter;
 }
@@ -1108,17 +1460,21 @@ static int solve_l2r_l1l2_svc(const problem *prob, const parameter *param, doubl
 // x, y, p, C
 // eps is the stopping tolerance
 //
-// solution will be put in w
+// beta holds the initial dual variables on entry
+// w_rest, if not NULL, is as in solve_l2r_l1l2_svc
+// solution will be put in w, and the dual solution in beta
 //
 // this function returns the number of iterations
 //
 // See Algorithm 4 of Ho and Lin, 2012
+//
+// param->nr_thread > 1 runs the sweeps with threads as solve_l2r_l1l2_svc does.
 
 #undef GETI
 #define GETI(i) (0)
 // To support weights for instances, use GETI(i) (i)
 
-static int solve_l2r_l1l2_svr(const problem *prob, const parameter *param, double *w, int max_iter=300)
+static int solve_l2r_l1l2_svr(const problem *prob, const parameter *param, double *w, double *beta, workspace *ws, int max_iter=300, const double *w_rest=NULL)
 {
 	const int solver_type = param->solver_type;
 	int l = prob->l;
@@ -1133,10 +1489,17 @@ static int solve_l2r_l1l2_svr(const problem *prob, const parameter *param, doubl
 	double d, G, H;
 	double Gmax_old = INF;
 	double Gmax_new, Gnorm1_new;
-	double Gnorm1_init = -1.0; // Gnorm1_init is initialized at the first iteration
-	double *beta = new double[l];
+	double Gnorm1_init = -1.0; // Gnorm1_init is initialized at the first iteration unless beta is given
 	double *QD = new double[l];
 	double *y = prob->y;
+	schar *shrunk = NULL;
+#ifdef _OPENMP
+	int nr_thread = param->nr_thread;
+	if(nr_thread > 1)
+		shrunk = new schar[l];
+#endif
+	size_t mem = solver_bytes(param->solver_type, l, w_size, 0, param->nr_thread);
+	ws->mem_alloc(mem);
 
 	// L2R_L2LOSS_SVR_DUAL
 	double lambda[1], upper_bound[1];
@@ -1149,18 +1512,28 @@ static int solve_l2r_l1l2_svr(const problem *prob, const parameter *param, doubl
 		upper_bound[0] = C;
 	}
 
-	// Initial beta can be set here. Note that
+	// The initial beta is clipped to
 	// -upper_bound <= beta[i] <= upper_bound
+	// With a nonzero beta, the stopping condition stays relative to
+	// the violation at beta = 0, which is max(|y_i|-p, 0) of each i.
 	for(i=0; i<l; i++)
-		beta[i] = 0;
+	{
+		beta[i] = min(max(beta[i], -upper_bound[GETI(i)]), upper_bound[GETI(i)]);
+		if(beta[i] != 0)
+			Gnorm1_init = 0;
+	}
+	if(Gnorm1_init == 0)
+		for(i=0; i<l; i++)
+			Gnorm1_init += max(fabs(y[i])-p, 0.0);
 
 	for(i=0; i<w_size; i++)
-		w[i] = 0;
+		w[i] = w_rest != NULL ? w_rest[i] : 0;
 	for(i=0; i<l; i++)
 	{
 		feature_node * const xi = prob->x[i];
-		QD[i] = sparse_operator::nrm2_sq(xi);
-		sparse_operator::axpy(beta[i], xi, w);
+		QD[i] = ws->xTx != NULL ? ws->xTx[i] : sparse_operator::nrm2_sq(xi);
+		if(beta[i] != 0)
+			sparse_operator::axpy(beta[i], xi, w);
 
 		index[i] = i;
 	}
@@ -1177,39 +1550,124 @@ static int solve_l2r_l1l2_svr(const problem *prob, const parameter *param, doubl
 			swap(index[i], index[j]);
 		}
 
-		for(s=0; s<active_size; s++)
+#ifdef _OPENMP
+		if(nr_thread > 1)
 		{
-			i = index[s];
-			G = -y[i] + lambda[GETI(i)]*beta[i];
-			H = QD[i] + lambda[GETI(i)];
-
-			feature_node * const xi = prob->x[i];
-			G += sparse_operator::dot(w, xi);
-
-			double Gp = G+p;
-			double Gn = G-p;
-			double violation = 0;
-			if(beta[i] == 0)
-			{
-				if(Gp < 0)
-					violation = -Gp;
-				else if(Gn > 0)
-					violation = Gn;
-				else if(Gp>Gmax_old && Gn<-Gmax_old)
-				{
-					active_size--;
-					swap(index[s], index[active_size]);
-					s--;
-					continue;
-				}
-			}
-			else if(beta[i] >= upper_bound[GETI(i)])
+#pragma omp parallel num_threads(nr_thread)
 			{
-				if(Gp > 0)
-					violation = Gp;
-				else if(Gp < -Gmax_old)
+				double Gmax_thread = 0;
+				double Gnorm1_thread = 0;
+#pragma omp for schedule(static)
+				for(int k=0; k<active_size; k++)
 				{
-					active_size--;
+					int ik = index[k];
+					double Hk = QD[ik] + lambda[GETI(ik)];
+					feature_node * const xi = prob->x[ik];
+					double Gk = -y[ik] + lambda[GETI(ik)]*beta[ik] + sparse_operator::dot(w, xi);
+					double Gp = Gk+p;
+					double Gn = Gk-p;
+					double violation = 0;
+
+					shrunk[k] = 0;
+					if(beta[ik] == 0)
+					{
+						if(Gp < 0)
+							violation = -Gp;
+						else if(Gn > 0)
+							violation = Gn;
+						else if(Gp>Gmax_old && Gn<-Gmax_old)
+							shrunk[k] = 1;
+					}
+					else if(beta[ik] >= upper_bound[GETI(ik)])
+					{
+						if(Gp > 0)
+							violation = Gp;
+						else if(Gp < -Gmax_old)
+							shrunk[k] = 1;
+					}
+					else if(beta[ik] <= -upper_bound[GETI(ik)])
+					{
+						if(Gn < 0)
+							violation = -Gn;
+						else if(Gn > Gmax_old)
+							shrunk[k] = 1;
+					}
+					else if(beta[ik] > 0)
+						violation = fabs(Gp);
+					else
+						violation = fabs(Gn);
+					if(shrunk[k])
+						continue;
+
+					Gmax_thread = max(Gmax_thread, violation);
+					Gnorm1_thread += violation;
+
+					double dk;
+					if(Gp < Hk*beta[ik])
+						dk = -Gp/Hk;
+					else if(Gn > Hk*beta[ik])
+						dk = -Gn/Hk;
+					else
+						dk = -beta[ik];
+
+					if(fabs(dk) < 1.0e-12)
+						continue;
+
+					double beta_old = beta[ik];
+					beta[ik] = min(max(beta[ik]+dk, -upper_bound[GETI(ik)]), upper_bound[GETI(ik)]);
+					dk = beta[ik]-beta_old;
+
+					if(dk != 0)
+						sparse_operator::axpy_atomic(dk, xi, w);
+				}
+#pragma omp critical
+				{
+					Gmax_new = max(Gmax_new, Gmax_thread);
+					Gnorm1_new += Gnorm1_thread;
+				}
+			}
+
+			int new_active_size = 0;
+			for(s=0; s<active_size; s++)
+				if(!shrunk[s])
+					swap(index[new_active_size++], index[s]);
+			active_size = new_active_size;
+		}
+		else
+#endif
+		for(s=0; s<active_size; s++)
+		{
+			i = index[s];
+			G = -y[i] + lambda[GETI(i)]*beta[i];
+			H = QD[i] + lambda[GETI(i)];
+
+			feature_node * const xi = prob->x[i];
+			G += sparse_operator::dot(w, xi);
+
+			double Gp = G+p;
+			double Gn = G-p;
+			double violation = 0;
+			if(beta[i] == 0)
+			{
+				if(Gp < 0)
+					violation = -Gp;
+				else if(Gn > 0)
+					violation = Gn;
+				else if(Gp>Gmax_old && Gn<-Gmax_old)
+				{
+					active_size--;
+					swap(index[s], index[active_size]);
+					s--;
+					continue;
+				}
+			}
+			else if(beta[i] >= upper_bound[GETI(i)])
+			{
+				if(Gp > 0)
+					violation = Gp;
+				else if(Gp < -Gmax_old)
+				{
+					active_size--;
 					swap(index[s], index[active_size]);
 					s--;
 					continue;
@@ -1254,11 +1712,12 @@ static int solve_l2r_l1l2_svr(const problem *prob, const parameter *param, doubl
 				sparse_operator::axpy(d, xi, w);
 		}
 
-		if(iter == 0)
+		if(iter == 0 && Gnorm1_init < 0)
 			Gnorm1_init = Gnorm1_new;
 		iter++;
 		if(iter % 10 == 0)
 			info(".");
+		ws->add_iter(iter, NAN, Gnorm1_new, active_size);
 
 		if(Gnorm1_new <= eps*Gnorm1_init)
 		{
@@ -1274,10 +1733,23 @@ static int solve_l2r_l1l2_svr(const problem *prob, const parameter *param, doubl
 		}
 
 		Gmax_old = Gmax_new;
+
+		if(ws->time_is_up())
+			break;
 	}
 
 	info("\noptimization finished, #iter = %d\n", iter);
 
+	// w drifted from sum(beta_i x_i) by the asynchronous updates of threads
+	if(shrunk != NULL)
+	{
+		for(i=0; i<w_size; i++)
+			w[i] = w_rest != NULL ? w_rest[i] : 0;
+		for(i=0; i<l; i++)
+			if(beta[i] != 0)
+				sparse_operator::axpy(beta[i], prob->x[i], w);
+	}
+
 	// calculate objective value
 	double v = 0;
 	int nSV = 0;
@@ -1294,9 +1766,10 @@ static int solve_l2r_l1l2_svr(const problem *prob, const parameter *param, doubl
 	info("Objective value = %lf\n", v);
 	info("nSV = %d\n",nSV);
 
-	delete [] beta;
 	delete [] QD;
 	delete [] index;
+	delete [] shrunk;
+	ws->mem_free(mem);
 
 	return iter;
 }
@@ -1316,17 +1789,21 @@ static int solve_l2r_l1l2_svr(const problem *prob, const parameter *param, doubl
 // x, y, Cp, Cn
 // eps is the stopping tolerance
 //
-// solution will be put in w
+// alpha_ret holds the initial dual variables on entry
+// w_rest, if not NULL, is as in solve_l2r_l1l2_svc
+// solution will be put in w, and the dual solution in alpha_ret
 //
 // this function returns the number of iterations
 //
 // See Algorithm 5 of Yu et al., MLJ 2010
+//
+// param->nr_thread > 1 runs the sweeps with threads as solve_l2r_l1l2_svc does.
 
 #undef GETI
 #define GETI(i) (y[i]+1)
 // To support weights for instances, use GETI(i) (i)
 
-static int solve_l2r_lr_dual(const problem *prob, const parameter *param, double *w, double Cp, double Cn, int max_iter=300)
+static int solve_l2r_lr_dual(const problem *prob, const parameter *param, double *w, double *alpha_ret, double Cp, double Cn, workspace *ws, int max_iter=300, const double *w_rest=NULL)
 {
 	int l = prob->l;
 	int w_size = prob->n;
@@ -1336,10 +1813,15 @@ static int solve_l2r_lr_dual(const problem *prob, const parameter *param, double
 	int *index = new int[l];
 	double *alpha = new double[2*l]; // store alpha and C - alpha
 	schar *y = new schar[l];
+	size_t mem = solver_bytes(param->solver_type, l, w_size, 0, param->nr_thread);
+	ws->mem_alloc(mem);
 	int max_inner_iter = 100; // for inner Newton
 	double innereps = 1e-2;
 	double innereps_min = min(1e-8, eps);
 	double upper_bound[3] = {Cn, 0, Cp};
+#ifdef _OPENMP
+	int nr_thread = param->nr_thread;
+#endif
 
 	for(i=0; i<l; i++)
 	{
@@ -1353,21 +1835,22 @@ static int solve_l2r_lr_dual(const problem *prob, const parameter *param, double
 		}
 	}
 
-	// Initial alpha can be set here. Note that
+	// The initial alpha is kept away from the bounds so that
 	// 0 < alpha[i] < upper_bound[GETI(i)]
 	// alpha[2*i] + alpha[2*i+1] = upper_bound[GETI(i)]
 	for(i=0; i<l; i++)
 	{
-		alpha[2*i] = min(0.001*upper_bound[GETI(i)], 1e-8);
+		double alpha_min = min(0.001*upper_bound[GETI(i)], 1e-8);
+		alpha[2*i] = min(max(alpha_ret[i], alpha_min), upper_bound[GETI(i)] - alpha_min);
 		alpha[2*i+1] = upper_bound[GETI(i)] - alpha[2*i];
 	}
 
 	for(i=0; i<w_size; i++)
-		w[i] = 0;
+		w[i] = w_rest != NULL ? w_rest[i] : 0;
 	for(i=0; i<l; i++)
 	{
 		feature_node * const xi = prob->x[i];
-		xTx[i] = sparse_operator::nrm2_sq(xi);
+		xTx[i] = ws->xTx != NULL ? ws->xTx[i] : sparse_operator::nrm2_sq(xi);
 		sparse_operator::axpy(y[i]*alpha[2*i], xi, w);
 		index[i] = i;
 	}
@@ -1381,6 +1864,66 @@ static int solve_l2r_lr_dual(const problem *prob, const parameter *param, double
 		}
 		int newton_iter = 0;
 		double Gmax = 0;
+#ifdef _OPENMP
+		if(nr_thread > 1)
+		{
+#pragma omp parallel num_threads(nr_thread)
+			{
+				double Gmax_thread = 0;
+#pragma omp for schedule(static) reduction(+:newton_iter)
+				for (int k=0; k<l; k++)
+				{
+					int ik = index[k];
+					const schar yi = y[ik];
+					double C = upper_bound[GETI(ik)];
+					feature_node * const xi = prob->x[ik];
+					double a = xTx[ik], b = yi*sparse_operator::dot(w, xi);
+
+					int ind1 = 2*ik, ind2 = 2*ik+1, sign = 1;
+					if(0.5*a*(alpha[ind2]-alpha[ind1])+b < 0)
+					{
+						ind1 = 2*ik+1;
+						ind2 = 2*ik;
+						sign = -1;
+					}
+
+					double alpha_old = alpha[ind1];
+					double z = alpha_old;
+					if(C - z < 0.5 * C)
+						z = 0.1*z;
+					double gp = a*(z-alpha_old)+sign*b+log(z/(C-z));
+					Gmax_thread = max(Gmax_thread, fabs(gp));
+
+					const double eta = 0.1;
+					int inner_iter = 0;
+					while (inner_iter <= max_inner_iter)
+					{
+						if(fabs(gp) < innereps)
+							break;
+						double gpp = a + C/(C-z)/z;
+						double tmpz = z - gp/gpp;
+						if(tmpz <= 0)
+							z *= eta;
+						else
+							z = tmpz;
+						gp = a*(z-alpha_old)+sign*b+log(z/(C-z));
+						newton_iter++;
+						inner_iter++;
+					}
+
+					if(inner_iter > 0)
+					{
+						alpha[ind1] = z;
+						alpha[ind2] = C-z;
+						sparse_operator::axpy_atomic(sign*(z-alpha_old)*yi, xi, w);
+					}
+				}
+#pragma omp critical
+				Gmax = max(Gmax, Gmax_thread);
+			}
+		}
+		else
+#endif
 		for (s=0; s<l; s++)
 		{
 			i = index[s];
@@ -1437,6 +1980,7 @@ static int solve_l2r_lr_dual(const problem *prob, const parameter *param, double
 		iter++;
 		if(iter % 10 == 0)
 			info(".");
+		ws->add_iter(iter, NAN, Gmax, l);
 
 		if(Gmax < eps)
 			break;
@@ -1444,10 +1988,23 @@ static int solve_l2r_lr_dual(const problem *prob, const parameter *param, double
 		if(newton_iter <= l/10)
 			innereps = max(innereps_min, 0.1*innereps);
 
+		if(ws->time_is_up())
+			break;
 	}
 
 	info("\noptimization finished, #iter = %d\n",iter);
 
+#ifdef _OPENMP
+	// w drifted from sum(alpha_i y_i x_i) by the asynchronous updates of threads
+	if(nr_thread > 1)
+	{
+		for(i=0; i<w_size; i++)
+			w[i] = w_rest != NULL ? w_rest[i] : 0;
+		for(i=0; i<l; i++)
+			sparse_operator::axpy(y[i]*alpha[2*i], prob->x[i], w);
+	}
+#endif
+
 	// calculate objective value
 
 	double v = 0;
@@ -1455,14 +2012,18 @@ static int solve_l2r_lr_dual(const problem *prob, const parameter *param, double
 		v += w[i] * w[i];
 	v *= 0.5;
 	for(i=0; i<l; i++)
-		v += alpha[2*i] * log(alpha[2*i]) + alpha[2*i+1] * log(alpha[2*i+1])
+		v += alpha[2*i] * vlog(alpha[2*i]) + alpha[2*i+1] * vlog(alpha[2*i+1])
 			- upper_bound[GETI(i)] * log(upper_bound[GETI(i)]);
 	info("Objective value = %lf\n", v);
 
+	for(i=0; i<l; i++)
+		alpha_ret[i] = alpha[2*i];
+
 	delete [] xTx;
 	delete [] alpha;
 	delete [] y;
 	delete [] index;
+	ws->mem_free(mem);
 
 	return iter;
 }
@@ -1484,12 +2045,19 @@ static int solve_l2r_lr_dual(const problem *prob, const parameter *param, double
 //
 // To not regularize the bias (i.e., regularize_bias = 0), a constant feature = 1
 // must have been added to the original data. (see -B and -R option)
+//
+// With param->nr_thread > 1, each sweep is run by threads in the way of
+// Shotgun (Bradley et al., ICML 2011): the shuffled features are split into
+// blocks of the threads, which update their own coordinates concurrently
+// and add the changes of b with atomic additions. The line search of a
+// coordinate may see the changes of other threads; b[] is recomputed after
+// the sweep if a line search fails, and at the end.
 
 #undef GETI
 #define GETI(i) (y[i]+1)
 // To support weights for instances, use GETI(i) (i)
 
-static int solve_l1r_l2_svc(const problem *prob_col, const parameter* param, double *w, double Cp, double Cn, double eps)
+static int solve_l1r_l2_svc(const problem *prob_col, const parameter* param, double *w, double Cp, double Cn, double eps, workspace *ws)
 {
 	int l = prob_col->l;
 	int w_size = prob_col->n;
@@ -1498,6 +2066,7 @@ static int solve_l1r_l2_svc(const problem *prob_col, const parameter* param, dou
 	int max_iter = 1000;
 	int active_size = w_size;
 	int max_num_linesearch = 20;
+	int nr_linesearch = 0; // backtracking steps, for the telemetry
 
 	double sigma = 0.01;
 	double d, G_loss, G, H;
@@ -1513,12 +2082,22 @@ static int solve_l1r_l2_svc(const problem *prob_col, const parameter* param, dou
 	double *b = new double[l]; // b = 1-ywTx
 	double *xj_sq = new double[w_size];
 	feature_node *x;
+	schar *shrunk = NULL;
+#ifdef _OPENMP
+	int nr_thread = param->nr_thread;
+	if(nr_thread > 1)
+		shrunk = new schar[w_size];
+#endif
+	size_t mem = solver_bytes(param->solver_type, l, w_size, 0, param->nr_thread);
+	ws->mem_alloc(mem);
 
 	double C[3] = {Cn,0,Cp};
 
-	// Initial w can be set here.
+	// w holds the initial solution
+	bool warm_start = false;
 	for(j=0; j<w_size; j++)
-		w[j] = 0;
+		if(w[j] != 0)
+			warm_start = true;
 
 	for(j=0; j<l; j++)
 	{
@@ -1544,6 +2123,23 @@ static int solve_l1r_l2_svc(const problem *prob_col, const parameter* param, dou
 		}
 	}
 
+	// with an initial w, the stopping condition stays relative to the
+	// violation at w = 0, where b[] = 1
+	if(warm_start)
+	{
+		Gnorm1_init = 0;
+		for(j=0; j<w_size; j++)
+		{
+			double G0 = 0;
+			for(x=prob_col->x[j]; x->index != -1; x++)
+				G0 -= 2*C[GETI(x->index-1)]*x->value;
+			if(j == w_size-1 && regularize_bias == 0)
+				Gnorm1_init += fabs(G0);
+			else
+				Gnorm1_init += max(fabs(G0)-1, 0.0);
+		}
+	}
+
 	while(iter < max_iter)
 	{
 		Gmax_new = 0;
@@ -1555,6 +2151,155 @@ static int solve_l1r_l2_svc(const problem *prob_col, const parameter* param, dou
 			swap(index[i], index[j]);
 		}
 
+#ifdef _OPENMP
+		if(nr_thread > 1)
+		{
+			bool recompute_b = false;
+#pragma omp parallel num_threads(nr_thread)
+			{
+				double Gmax_thread = 0, Gnorm1_thread = 0;
+				int nr_linesearch_thread = 0;
+#pragma omp for schedule(static)
+				for(int k=0; k<active_size; k++)
+				{
+					int jk = index[k];
+					double G_loss_k = 0, H_k = 0;
+					feature_node *xk;
+
+					shrunk[k] = 0;
+					for(xk=prob_col->x[jk]; xk->index != -1; xk++)
+					{
+						int ind = xk->index-1;
+						double b_ind = b[ind];
+						if(b_ind > 0)
+						{
+							double tmp = C[GETI(ind)]*xk->value;
+							G_loss_k -= tmp*b_ind;
+							H_k += tmp*xk->value;
+						}
+					}
+					G_loss_k *= 2;
+
+					double Gk = G_loss_k;
+					H_k = max(H_k*2, 1e-12);
+
+					double violation = 0;
+					double Gp = 0, Gn = 0;
+					bool is_bias = jk == w_size-1 && regularize_bias == 0;
+					if(is_bias)
+						violation = fabs(Gk);
+					else
+					{
+						Gp = Gk+1;
+						Gn = Gk-1;
+						if(w[jk] == 0)
+						{
+							if(Gp < 0)
+								violation = -Gp;
+							else if(Gn > 0)
+								violation = Gn;
+							else if(Gp>Gmax_old/l && Gn<-Gmax_old/l)
+							{
+								shrunk[k] = 1;
+								continue;
+							}
+						}
+						else if(w[jk] > 0)
+							violation = fabs(Gp);
+						else
+							violation = fabs(Gn);
+					}
+					Gmax_thread = max(Gmax_thread, violation);
+					Gnorm1_thread += violation;
+
+					double dk;
+					if(is_bias)
+						dk = -Gk/H_k;
+					else if(Gp < H_k*w[jk])
+						dk = -Gp/H_k;
+					else if(Gn > H_k*w[jk])
+						dk = -Gn/H_k;
+					else
+						dk = -w[jk];
+
+					if(fabs(dk) < 1.0e-12)
+						continue;
+
+					double delta_k = is_bias ? Gk*dk : fabs(w[jk]+dk)-fabs(w[jk]) + Gk*dk;
+					double dk_old = 0, loss_old_k = 0;
+					int num_linesearch;
+					for(num_linesearch=0; num_linesearch < max_num_linesearch; num_linesearch++)
+					{
+						double dk_diff = dk_old - dk;
+						double cond_k = is_bias ? -sigma*delta_k : fabs(w[jk]+dk)-fabs(w[jk]) - sigma*delta_k;
+
+						if(xj_sq[jk]*dk*dk + G_loss_k*dk + cond_k <= 0)
+						{
+							sparse_operator::axpy_atomic(dk_diff, prob_col->x[jk], b);
+							break;
+						}
+
+						double loss_new_k = 0;
+						for(xk=prob_col->x[jk]; xk->index != -1; xk++)
+						{
+							int ind = xk->index-1;
+							double v = dk_diff*xk->value;
+							double b_ind = b[ind];
+							if(num_linesearch == 0 && b_ind > 0)
+								loss_old_k += C[GETI(ind)]*b_ind*b_ind;
+#pragma omp atomic
+							b[ind] += v;
+							double b_new = b_ind + v;
+							if(b_new > 0)
+								loss_new_k += C[GETI(ind)]*b_new*b_new;
+						}
+
+						if(cond_k + loss_new_k - loss_old_k <= 0)
+							break;
+						dk_old = dk;
+						dk *= 0.5;
+						delta_k *= 0.5;
+					}
+
+					w[jk] += dk;
+					nr_linesearch_thread += num_linesearch;
+					if(num_linesearch >= max_num_linesearch)
+					{
+#pragma omp critical
+						recompute_b = true;
+					}
+				}
+#pragma omp critical
+				{
+					Gmax_new = max(Gmax_new, Gmax_thread);
+					Gnorm1_new += Gnorm1_thread;
+					nr_linesearch += nr_linesearch_thread;
+				}
+			}
+
+			int new_active_size = 0;
+			for(s=0; s<active_size; s++)
+				if(!shrunk[s])
+					swap(index[new_active_size++], index[s]);
+			active_size = new_active_size;
+
+			// recompute b[] if line search takes too many steps
+			if(recompute_b)
+			{
+				info("#");
+				for(int i=0; i<l; i++)
+					b[i] = 1;
+
+				for(int i=0; i<w_size; i++)
+				{
+					if(w[i]==0) continue;
+					x = prob_col->x[i];
+					sparse_operator::axpy(-w[i], x, b);
+				}
+			}
+		}
+		else
+#endif
 		for(s=0; s<active_size; s++)
 		{
 			j = index[s];
@@ -1693,6 +2438,7 @@ static int solve_l1r_l2_svc(const problem *prob_col, const parameter* param, dou
 			}
 
 			w[j] += d;
+			nr_linesearch += num_linesearch;
 
 			// recompute b[] if line search takes too many steps
 			if(num_linesearch >= max_num_linesearch)
@@ -1710,11 +2456,12 @@ static int solve_l1r_l2_svc(const problem *prob_col, const parameter* param, dou
 			}
 		}
 
-		if(iter == 0)
+		if(iter == 0 && !warm_start)
 			Gnorm1_init = Gnorm1_new;
 		iter++;
 		if(iter % 10 == 0)
 			info(".");
+		ws->add_iter(iter, NAN, Gnorm1_new, active_size);
 
 		if(Gnorm1_new <= eps*Gnorm1_init)
 		{
@@ -1730,11 +2477,26 @@ static int solve_l1r_l2_svc(const problem *prob_col, const parameter* param, dou
 		}
 
 		Gmax_old = Gmax_new;
+
+		if(ws->time_is_up())
+			break;
 	}
 
 	info("\noptimization finished, #iter = %d\n", iter);
 	if(iter >= max_iter)
 		info("\nWARNING: reaching max number of iterations\n");
+	if(ws->stat)
+		ws->stat->nr_linesearch += nr_linesearch;
+
+	// b[] of the asynchronous updates is recomputed for the objective value
+	if(shrunk != NULL)
+	{
+		for(j=0; j<l; j++)
+			b[j] = 1;
+		for(j=0; j<w_size; j++)
+			if(w[j] != 0)
+				sparse_operator::axpy(-w[j], prob_col->x[j], b);
+	}
 
 	// calculate objective value
 
@@ -1767,6 +2529,8 @@ static int solve_l1r_l2_svc(const problem *prob_col, const parameter* param, dou
 	delete [] y;
 	delete [] b;
 	delete [] xj_sq;
+	delete [] shrunk;
+	ws->mem_free(mem);
 
 	return iter;
 }
@@ -1788,12 +2552,18 @@ static int solve_l1r_l2_svc(const problem *prob_col, const parameter* param, dou
 //
 // To not regularize the bias (i.e., regularize_bias = 0), a constant feature = 1
 // must have been added to the original data. (see -B and -R option)
+//
+// With param->nr_thread > 1, the gradient and the Hessian diagonal of the
+// features are computed by threads, the sums over instances in the line
+// search are parallel reductions, and the sweeps of the QP are run as
+// those of solve_l1r_l2_svc, with atomic additions to xTd. The QP only
+// gives the direction, so the line search keeps the descent.
 
 #undef GETI
 #define GETI(i) (y[i]+1)
 // To support weights for instances, use GETI(i) (i)
 
-static int solve_l1r_lr(const problem *prob_col, const parameter *param, double *w, double Cp, double Cn, double eps)
+static int solve_l1r_lr(const problem *prob_col, const parameter *param, double *w, double Cp, double Cn, double eps, workspace *ws)
 {
 	int l = prob_col->l;
 	int w_size = prob_col->n;
@@ -1828,13 +2598,25 @@ static int solve_l1r_lr(const problem *prob_col, const parameter *param, double
 	double *exp_wTx_new = new double[l];
 	double *tau = new double[l];
 	double *D = new double[l];
+	const int block_size = 256;
+	double buf[block_size];
 	feature_node *x;
+	schar *shrunk = NULL;
+#ifdef _OPENMP
+	int nr_thread = param->nr_thread;
+	if(nr_thread > 1)
+		shrunk = new schar[w_size];
+#endif
+	size_t mem = solver_bytes(param->solver_type, l, w_size, 0, param->nr_thread);
+	ws->mem_alloc(mem);
 
 	double C[3] = {Cn,0,Cp};
 
-	// Initial w can be set here.
+	// w holds the initial solution
+	bool warm_start = false;
 	for(j=0; j<w_size; j++)
-		w[j] = 0;
+		if(w[j] != 0)
+			warm_start = true;
 
 	for(j=0; j<l; j++)
 	{
@@ -1867,20 +2649,102 @@ static int solve_l1r_lr(const problem *prob_col, const parameter *param, double
 	if (regularize_bias == 0)
 		w_norm -= fabs(w[w_size-1]);
 
+	for(j=0; j<l; j++)
+		exp_wTx[j] = vexp(exp_wTx[j]);
 	for(j=0; j<l; j++)
 	{
-		exp_wTx[j] = exp(exp_wTx[j]);
 		double tau_tmp = 1/(1+exp_wTx[j]);
 		tau[j] = C[GETI(j)]*tau_tmp;
 		D[j] = C[GETI(j)]*exp_wTx[j]*tau_tmp*tau_tmp;
 	}
 
+	// with an initial w, the stopping condition stays relative to the
+	// violation at w = 0, where tau[i] = C[GETI(i)]/2
+	if(warm_start)
+	{
+		Gnorm1_init = 0;
+		for(j=0; j<w_size; j++)
+		{
+			double G0 = xjneg_sum[j];
+			for(x=prob_col->x[j]; x->index != -1; x++)
+				G0 -= 0.5*C[GETI(x->index-1)]*x->value;
+			if(j == w_size-1 && regularize_bias == 0)
+				Gnorm1_init += fabs(G0);
+			else
+				Gnorm1_init += max(fabs(G0)-1, 0.0);
+		}
+	}
+
 	while(newton_iter < max_newton_iter)
 	{
 		Gmax_new = 0;
 		Gnorm1_new = 0;
 		active_size = w_size;
 
+#ifdef _OPENMP
+		if(nr_thread > 1)
+		{
+#pragma omp parallel num_threads(nr_thread)
+			{
+				double Gmax_thread = 0, Gnorm1_thread = 0;
+#pragma omp for schedule(static)
+				for(int k=0; k<active_size; k++)
+				{
+					int jk = index[k];
+					double Hdiag_k = nu, tmp = 0;
+					for(feature_node *xk=prob_col->x[jk]; xk->index != -1; xk++)
+					{
+						int ind = xk->index-1;
+						Hdiag_k += xk->value*xk->value*D[ind];
+						tmp += xk->value*tau[ind];
+					}
+					Hdiag[jk] = Hdiag_k;
+					Grad[jk] = -tmp + xjneg_sum[jk];
+
+					double violation = 0;
+					shrunk[k] = 0;
+					if (jk == w_size-1 && regularize_bias == 0)
+						violation = fabs(Grad[jk]);
+					else
+					{
+						double Gp = Grad[jk]+1;
+						double Gn = Grad[jk]-1;
+						if(w[jk] == 0)
+						{
+							if(Gp < 0)
+								violation = -Gp;
+							else if(Gn > 0)
+								violation = Gn;
+							//outer-level shrinking
+							else if(Gp>Gmax_old/l && Gn<-Gmax_old/l)
+							{
+								shrunk[k] = 1;
+								continue;
+							}
+						}
+						else if(w[jk] > 0)
+							violation = fabs(Gp);
+						else
+							violation = fabs(Gn);
+					}
+					Gmax_thread = max(Gmax_thread, violation);
+					Gnorm1_thread += violation;
+				}
+#pragma omp critical
+				{
+					Gmax_new = max(Gmax_new, Gmax_thread);
+					Gnorm1_new += Gnorm1_thread;
+				}
+			}
+
+			int new_active_size = 0;
+			for(s=0; s<active_size; s++)
+				if(!shrunk[s])
+					swap(index[new_active_size++], index[s]);
+			active_size = new_active_size;
+		}
+		else
+#endif
 		for(s=0; s<active_size; s++)
 		{
 			j = index[s];
@@ -1929,7 +2793,7 @@ static int solve_l1r_lr(const problem *prob_col, const parameter *param, double
 			Gnorm1_new += violation;
 		}
 
-		if(newton_iter == 0)
+		if(newton_iter == 0 && !warm_start)
 			Gnorm1_init = Gnorm1_new;
 
 		if(Gnorm1_new <= eps*Gnorm1_init)
@@ -1954,6 +2818,87 @@ static int solve_l1r_lr(const problem *prob_col, const parameter *param, double
 				swap(index[i], index[j]);
 			}
 
+#ifdef _OPENMP
+			if(nr_thread > 1)
+			{
+#pragma omp parallel num_threads(nr_thread)
+				{
+					double Gmax_thread = 0, Gnorm1_thread = 0;
+#pragma omp for schedule(static)
+					for(int k=0; k<QP_active_size; k++)
+					{
+						int jk = index[k];
+						double Hk = Hdiag[jk], zk;
+						double Gk = Grad[jk] + (wpd[jk]-w[jk])*nu;
+						for(feature_node *xk=prob_col->x[jk]; xk->index != -1; xk++)
+						{
+							int ind = xk->index-1;
+							Gk += xk->value*D[ind]*xTd[ind];
+						}
+
+						double violation = 0;
+						shrunk[k] = 0;
+						if (jk == w_size-1 && regularize_bias == 0)
+						{
+							// bias term not shrunken
+							violation = fabs(Gk);
+							zk = -Gk/Hk;
+						}
+						else
+						{
+							double Gp = Gk+1;
+							double Gn = Gk-1;
+							if(wpd[jk] == 0)
+							{
+								if(Gp < 0)
+									violation = -Gp;
+								else if(Gn > 0)
+									violation = Gn;
+								//inner-level shrinking
+								else if(Gp>QP_Gmax_old/l && Gn<-QP_Gmax_old/l)
+								{
+									shrunk[k] = 1;
+									continue;
+								}
+							}
+							else if(wpd[jk] > 0)
+								violation = fabs(Gp);
+							else
+								violation = fabs(Gn);
+
+							// obtain solution of one-variable problem
+							if(Gp < Hk*wpd[jk])
+								zk = -Gp/Hk;
+							else if(Gn > Hk*wpd[jk])
+								zk = -Gn/Hk;
+							else
+								zk = -wpd[jk];
+						}
+						Gmax_thread = max(Gmax_thread, violation);
+						Gnorm1_thread += violation;
+
+						if(fabs(zk) < 1.0e-12)
+							continue;
+						zk = min(max(zk,-10.0),10.0);
+
+						wpd[jk] += zk;
+						sparse_operator::axpy_atomic(zk, prob_col->x[jk], xTd);
+					}
+#pragma omp critical
+					{
+						QP_Gmax_new = max(QP_Gmax_new, Gmax_thread);
+						QP_Gnorm1_new += Gnorm1_thread;
+					}
+				}
+
+				int new_active_size = 0;
+				for(s=0; s<QP_active_size; s++)
+					if(!shrunk[s])
+						swap(index[new_active_size++], index[s]);
+				QP_active_size = new_active_size;
+			}
+			else
+#endif
 			for(s=0; s<QP_active_size; s++)
 			{
 				j = index[s];
@@ -2037,6 +2982,10 @@ static int solve_l1r_lr(const problem *prob_col, const parameter *param, double
 			}
 
 			QP_Gmax_old = QP_Gmax_new;
+
+			// the direction wpd-w so far is still a descent direction
+			if(ws->time_is_up())
+				break;
 		}
 
 		if(iter >= max_iter)
@@ -2055,6 +3004,18 @@ static int solve_l1r_lr(const problem *prob_col, const parameter *param, double
 		delta += (w_norm_new-w_norm);
 
 		negsum_xTd = 0;
+#ifdef _OPENMP
+		if(nr_thread > 1)
+		{
+			double sum = 0;
+#pragma omp parallel for schedule(static) num_threads(nr_thread) reduction(+:sum)
+			for(int i=0; i<l; i++)
+				if(y[i] == -1)
+					sum += C[GETI(i)]*xTd[i];
+			negsum_xTd = sum;
+		}
+		else
+#endif
 		for(int i=0; i<l; i++)
 			if(y[i] == -1)
 				negsum_xTd += C[GETI(i)]*xTd[i];
@@ -2064,11 +3025,43 @@ static int solve_l1r_lr(const problem *prob_col, const parameter *param, double
 		{
 			cond = w_norm_new - w_norm + negsum_xTd - sigma*delta;
 
-			for(int i=0; i<l; i++)
+#ifdef _OPENMP
+			if(nr_thread > 1)
+			{
+				double sum = 0;
+#pragma omp parallel num_threads(nr_thread) reduction(+:sum)
+				{
+					double buf_thread[block_size];
+#pragma omp for schedule(static)
+					for(int start=0; start<l; start+=block_size)
+					{
+						int len = min(block_size, l-start);
+						for(int i=start; i<start+len; i++)
+						{
+							double exp_xTd = vexp(xTd[i]);
+							exp_wTx_new[i] = exp_wTx[i]*exp_xTd;
+							buf_thread[i-start] = vlog((1+exp_wTx_new[i])/(exp_xTd+exp_wTx_new[i]));
+						}
+						for(int i=start; i<start+len; i++)
+							sum += C[GETI(i)]*buf_thread[i-start];
+					}
+				}
+				cond += sum;
+			}
+			else
+#endif
+			// the terms of a block are stored in a buffer first, so the loop is vectorized
+			for(int start=0; start<l; start+=block_size)
 			{
-				double exp_xTd = exp(xTd[i]);
-				exp_wTx_new[i] = exp_wTx[i]*exp_xTd;
-				cond += C[GETI(i)]*log((1+exp_wTx_new[i])/(exp_xTd+exp_wTx_new[i]));
+				int len = min(block_size, l-start);
+				for(int i=start; i<start+len; i++)
+				{
+					double exp_xTd = vexp(xTd[i]);
+					exp_wTx_new[i] = exp_wTx[i]*exp_xTd;
+					buf[i-start] = vlog((1+exp_wTx_new[i])/(exp_xTd+exp_wTx_new[i]));
+				}
+				for(int i=start; i<start+len; i++)
+					cond += C[GETI(i)]*buf[i-start];
 			}
 
 			if(cond <= 0)
@@ -2076,6 +3069,9 @@ static int solve_l1r_lr(const problem *prob_col, const parameter *param, double
 				w_norm = w_norm_new;
 				for(j=0; j<w_size; j++)
 					w[j] = wpd[j];
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) num_threads(nr_thread) if(nr_thread > 1)
+#endif
 				for(int i=0; i<l; i++)
 				{
 					exp_wTx[i] = exp_wTx_new[i];
@@ -2103,6 +3099,9 @@ static int solve_l1r_lr(const problem *prob_col, const parameter *param, double
 			}
 		}
 
+		if(ws->stat)
+			ws->stat->nr_linesearch += num_linesearch;
+
 		// Recompute some info due to too many line search steps
 		if(num_linesearch >= max_num_linesearch)
 		{
@@ -2117,7 +3116,7 @@ static int solve_l1r_lr(const problem *prob_col, const parameter *param, double
 			}
 
 			for(int i=0; i<l; i++)
-				exp_wTx[i] = exp(exp_wTx[i]);
+				exp_wTx[i] = vexp(exp_wTx[i]);
 		}
 
 		if(iter == 1)
@@ -2127,6 +3126,10 @@ static int solve_l1r_lr(const problem *prob_col, const parameter *param, double
 		Gmax_old = Gmax_new;
 
 		info("iter %3d  #CD cycles %d\n", newton_iter, iter);
+		ws->add_iter(newton_iter, NAN, Gnorm1_new, active_size);
+
+		if(ws->time_is_up())
+			break;
 	}
 
 	info("=========================\n");
@@ -2166,6 +3169,8 @@ static int solve_l1r_lr(const problem *prob_col, const parameter *param, double
 	delete [] exp_wTx_new;
 	delete [] tau;
 	delete [] D;
+	delete [] shrunk;
+	ws->mem_free(mem);
 
 	return newton_iter;
 }
@@ -2227,8 +3232,62 @@ static void quick_select_min_k(feature_node *nodes, int low, int high, int k)
 		return quick_select_min_k(nodes, pivot+1, high, k);
 }
 
-// A two-level coordinate descent algorithm for
-// a scaled one-class SVM dual problem
+#ifdef _OPENMP
+// Moves the k smallest of nodes[0:len] in sorted order to nodes[0:k].
+// Unlike quick_select_min_k, the pivot is the median of three instead of
+// a random one, so threads can call it at the same time.
+static void select_sorted_min_k(feature_node *nodes, int len, int k)
+{
+	int low = 0, high = len-1;
+	while(low < high && low <= k-1 && k-1 <= high)
+	{
+		int mid = low + (high-low)/2;
+		if(compare_feature_node(&nodes[mid], &nodes[low]) == -1)
+			swap(nodes[mid], nodes[low]);
+		if(compare_feature_node(&nodes[high], &nodes[low]) == -1)
+			swap(nodes[high], nodes[low]);
+		if(compare_feature_node(&nodes[mid], &nodes[high]) == -1)
+			swap(nodes[mid], nodes[high]);
+		// nodes[high] is now the median of the three
+
+		int index = low;
+		for(int i=low; i<high; i++)
+			if(compare_feature_node(&nodes[i], &nodes[high]) == -1)
+				swap(nodes[index++], nodes[i]);
+		swap(nodes[high], nodes[index]);
+
+		if(index == k-1)
+			break;
+		else if(k-1 < index)
+			high = index-1;
+		else
+			low = index+1;
+	}
+	qsort(nodes, k, sizeof(feature_node), compare_feature_node);
+}
+
+// Merges the sorted runs nodes[start[r]:start[r]+len[r]], r < nr_run,
+// until the k smallest are in out
+static void merge_min_k(const feature_node *nodes, const int *start, const int *len, int nr_run, int k, feature_node *out)
+{
+	int *head = new int[nr_run];
+	for(int r=0; r<nr_run; r++)
+		head[r] = 0;
+	for(int s=0; s<k; s++)
+	{
+		int min_r = -1;
+		for(int r=0; r<nr_run; r++)
+			if(head[r] < len[r] && (min_r < 0 ||
+				compare_feature_node(&nodes[start[r]+head[r]], &nodes[start[min_r]+head[min_r]]) == -1))
+				min_r = r;
+		out[s] = nodes[start[min_r]+head[min_r]++];
+	}
+	delete [] head;
+}
+#endif
+
+// A two-level coordinate descent algorithm for
+// a scaled one-class SVM dual problem
 //
 //  min_\alpha  0.5(\alpha^T Q \alpha),
 //    s.t.      0 <= \alpha_i <= 1 and
@@ -2245,8 +3304,14 @@ static void quick_select_min_k(feature_node *nodes, int low, int high, int k)
 // this function returns the number of iterations
 //
 // See Algorithm 7 in supplementary materials of Chou et al., SDM 2020.
+//
+// With nr_thread > 1, the gradient is computed in parallel, and each thread
+// selects and sorts the candidates of its block of the active set; the
+// sorted runs are merged into the pairs. As the order of the candidates is
+// total, the pairs and the solution are the same as the serial ones. The
+// pairs are still updated one by one.
 
-static int solve_oneclass_svm(const problem *prob, const parameter *param, double *w, double *rho)
+static int solve_oneclass_svm(const problem *prob, const parameter *param, double *w, double *rho, workspace *ws)
 {
 	int l = prob->l;
 	int w_size = prob->n;
@@ -2269,6 +3334,27 @@ static int solve_oneclass_svm(const problem *prob, const parameter *param, doubl
 	// Iup = { i | alpha_i < 1 }, Ilow = { i | alpha_i > 0 }
 	feature_node *max_negG_of_Iup = new feature_node[l];
 	feature_node *min_negG_of_Ilow = new feature_node[l];
+#ifdef _OPENMP
+	int nr_thread = param->nr_thread;
+	schar *shrunk = NULL;
+	// the block of each thread in the active set, and its candidates
+	int *block_start = NULL, *nr_Iup = NULL, *nr_Ilow = NULL, *nr_kept = NULL;
+	// the merged pairs: Iup by ascending G with index -i (so ties are in
+	// the order of the serial selection), and Ilow as in the serial one
+	feature_node *top_Iup = NULL, *top_Ilow = NULL;
+	if(nr_thread > 1)
+	{
+		shrunk = new schar[l];
+		block_start = new int[nr_thread];
+		nr_Iup = new int[nr_thread];
+		nr_Ilow = new int[nr_thread];
+		nr_kept = new int[nr_thread];
+		top_Iup = new feature_node[l/10+1];
+		top_Ilow = new feature_node[l/10+1];
+	}
+#endif
+	size_t mem = solver_bytes(param->solver_type, l, w_size, 0, param->nr_thread);
+	ws->mem_alloc(mem);
 	feature_node node;
 
 	int n = (int)(nu*l);            // # of alpha's at upper bound
@@ -2284,8 +3370,9 @@ static int solve_oneclass_svm(const problem *prob, const parameter *param, doubl
 	for(i=0; i<l; i++)
 	{
 		feature_node * const xi = prob->x[i];
-		QD[i] = sparse_operator::nrm2_sq(xi);
-		sparse_operator::axpy(alpha[i], xi, w);
+		QD[i] = ws->xTx != NULL ? ws->xTx[i] : sparse_operator::nrm2_sq(xi);
+		if(alpha[i] != 0)
+			sparse_operator::axpy(alpha[i], xi, w);
 
 		index[i] = i;
 	}
@@ -2295,6 +3382,32 @@ static int solve_oneclass_svm(const problem *prob, const parameter *param, doubl
 		negGmax = -INF;
 		negGmin = INF;
 
+#ifdef _OPENMP
+		if(nr_thread > 1)
+		{
+#pragma omp parallel num_threads(nr_thread)
+			{
+				double negGmax_thread = -INF;
+				double negGmin_thread = INF;
+#pragma omp for schedule(static)
+				for (int k=0; k<active_size; k++)
+				{
+					int ik = index[k];
+					G[ik] = sparse_operator::dot(w, prob->x[ik]);
+					if (alpha[ik] < 1)
+						negGmax_thread = max(negGmax_thread, -G[ik]);
+					if (alpha[ik] > 0)
+						negGmin_thread = min(negGmin_thread, -G[ik]);
+				}
+#pragma omp critical
+				{
+					negGmax = max(negGmax, negGmax_thread);
+					negGmin = min(negGmin, negGmin_thread);
+				}
+			}
+		}
+		else
+#endif
 		for (s=0; s<active_size; s++)
 		{
 			i = index[s];
@@ -2318,51 +3431,126 @@ static int solve_oneclass_svm(const problem *prob, const parameter *param, doubl
 			}
 		}
 
-		for(s=0; s<active_size; s++)
+		int len_Iup = 0;
+		int len_Ilow = 0;
+#ifdef _OPENMP
+		if(nr_thread > 1)
 		{
-			i = index[s];
-			if ((alpha[i] == 1 && -G[i] > negGmax) ||
-			    (alpha[i] == 0 && -G[i] < negGmin))
+			int nr_block = 1;
+#pragma omp parallel num_threads(nr_thread)
 			{
-				active_size--;
-				swap(index[s], index[active_size]);
-				s--;
+				int nt = omp_get_num_threads();
+				int t = omp_get_thread_num();
+				int start = (int)((long long)active_size*t/nt);
+				int end = (int)((long long)active_size*(t+1)/nt);
+				int n_up = 0, n_low = 0, n_kept = 0;
+				for (int k=start; k<end; k++)
+				{
+					int ik = index[k];
+					shrunk[k] = (alpha[ik] == 1 && -G[ik] > negGmax) ||
+					            (alpha[ik] == 0 && -G[ik] < negGmin);
+					if (shrunk[k])
+						continue;
+					n_kept++;
+					if (alpha[ik] < 1)
+					{
+						max_negG_of_Iup[start+n_up].index = -ik;
+						max_negG_of_Iup[start+n_up++].value = G[ik];
+					}
+					if (alpha[ik] > 0)
+					{
+						min_negG_of_Ilow[start+n_low].index = ik;
+						min_negG_of_Ilow[start+n_low++].value = -G[ik];
+					}
+				}
+				block_start[t] = start;
+				nr_Iup[t] = n_up;
+				nr_Ilow[t] = n_low;
+				nr_kept[t] = n_kept;
+#pragma omp barrier
+#pragma omp single
+				{
+					int new_active_size = 0;
+					for (int r=0; r<nt; r++)
+					{
+						len_Iup += nr_Iup[r];
+						len_Ilow += nr_Ilow[r];
+						new_active_size += nr_kept[r];
+					}
+					max_inner_iter = min(max(new_active_size/10, 1), min(len_Iup, len_Ilow));
+					nr_block = nt;
+				}
+				nr_Iup[t] = min(nr_Iup[t], max_inner_iter);
+				nr_Ilow[t] = min(nr_Ilow[t], max_inner_iter);
+				select_sorted_min_k(&max_negG_of_Iup[start], n_up, nr_Iup[t]);
+				select_sorted_min_k(&min_negG_of_Ilow[start], n_low, nr_Ilow[t]);
 			}
+			merge_min_k(max_negG_of_Iup, block_start, nr_Iup, nr_block, max_inner_iter, top_Iup);
+			merge_min_k(min_negG_of_Ilow, block_start, nr_Ilow, nr_block, max_inner_iter, top_Ilow);
+
+			int new_active_size = 0;
+			for (s=0; s<active_size; s++)
+				if (!shrunk[s])
+					swap(index[new_active_size++], index[s]);
+			active_size = new_active_size;
 		}
-
-		max_inner_iter = max(active_size/10, 1);
-		int len_Iup = 0;
-		int len_Ilow = 0;
-		for(s=0; s<active_size; s++)
+		else
+#endif
 		{
-			i = index[s];
-			node.index = i;
-			node.value = -G[i];
-
-			if (alpha[i] < 1)
+			for(s=0; s<active_size; s++)
 			{
-				max_negG_of_Iup[len_Iup] = node;
-				len_Iup++;
+				i = index[s];
+				if ((alpha[i] == 1 && -G[i] > negGmax) ||
+				    (alpha[i] == 0 && -G[i] < negGmin))
+				{
+					active_size--;
+					swap(index[s], index[active_size]);
+					s--;
+				}
 			}
 
-			if (alpha[i] > 0)
+			max_inner_iter = max(active_size/10, 1);
+			for(s=0; s<active_size; s++)
 			{
-				min_negG_of_Ilow[len_Ilow] = node;
-				len_Ilow++;
+				i = index[s];
+				node.index = i;
+				node.value = -G[i];
+
+				if (alpha[i] < 1)
+				{
+					max_negG_of_Iup[len_Iup] = node;
+					len_Iup++;
+				}
+
+				if (alpha[i] > 0)
+				{
+					min_negG_of_Ilow[len_Ilow] = node;
+					len_Ilow++;
+				}
 			}
-		}
-		max_inner_iter = min(max_inner_iter, min(len_Iup, len_Ilow));
+			max_inner_iter = min(max_inner_iter, min(len_Iup, len_Ilow));
 
-		quick_select_min_k(max_negG_of_Iup, 0, len_Iup-1, len_Iup-max_inner_iter);
-		qsort(&(max_negG_of_Iup[len_Iup-max_inner_iter]), max_inner_iter, sizeof(struct feature_node), compare_feature_node);
+			quick_select_min_k(max_negG_of_Iup, 0, len_Iup-1, len_Iup-max_inner_iter);
+			qsort(&(max_negG_of_Iup[len_Iup-max_inner_iter]), max_inner_iter, sizeof(struct feature_node), compare_feature_node);
 
-		quick_select_min_k(min_negG_of_Ilow, 0, len_Ilow-1, max_inner_iter);
-		qsort(min_negG_of_Ilow, max_inner_iter, sizeof(struct feature_node), compare_feature_node);
+			quick_select_min_k(min_negG_of_Ilow, 0, len_Ilow-1, max_inner_iter);
+			qsort(min_negG_of_Ilow, max_inner_iter, sizeof(struct feature_node), compare_feature_node);
+		}
 
 		for (s=0; s<max_inner_iter; s++)
 		{
-			i = max_negG_of_Iup[len_Iup-s-1].index;
-			j = min_negG_of_Ilow[s].index;
+#ifdef _OPENMP
+			if(nr_thread > 1)
+			{
+				i = -top_Iup[s].index;
+				j = top_Ilow[s].index;
+			}
+			else
+#endif
+			{
+				i = max_negG_of_Iup[len_Iup-s-1].index;
+				j = min_negG_of_Ilow[s].index;
+			}
 
 			if ((alpha[i] == 0 && alpha[j] == 0) ||
 			    (alpha[i] == 1 && alpha[j] == 1))
@@ -2431,6 +3619,10 @@ static int solve_oneclass_svm(const problem *prob, const parameter *param, doubl
 		iter++;
 		if (iter % 10 == 0)
 			info(".");
+		ws->add_iter(iter, NAN, negGmax - negGmin, active_size);
+
+		if (ws->time_is_up())
+			break;
 	}
 	info("\noptimization finished, #iter = %d\n",iter);
 	if (iter >= max_iter)
@@ -2478,12 +3670,26 @@ static int solve_oneclass_svm(const problem *prob, const parameter *param, doubl
 	delete [] alpha;
 	delete [] max_negG_of_Iup;
 	delete [] min_negG_of_Ilow;
+#ifdef _OPENMP
+	delete [] shrunk;
+	delete [] block_start;
+	delete [] nr_Iup;
+	delete [] nr_Ilow;
+	delete [] nr_kept;
+	delete [] top_Iup;
+	delete [] top_Ilow;
+#endif
+	ws->mem_free(mem);
 
 	return iter;
 }
 
 // transpose matrix X from row format to column format
-static void transpose(const problem *prob, feature_node **x_space_ret, problem *prob_col)
+// With nr_thread > 1, each thread counts and fills the entries of a block
+// of rows. The counts of the threads give their positions in the columns,
+// so the result is the same as the serial one; the counts take
+// nr_thread*n extra elements.
+static void transpose(const problem *prob, feature_node **x_space_ret, problem *prob_col, int nr_thread)
 {
 	int i;
 	int l = prob->l;
@@ -2499,6 +3705,77 @@ static void transpose(const problem *prob, feature_node **x_space_ret, problem *
 	for(i=0; i<l; i++)
 		prob_col->y[i] = prob->y[i];
 
+#ifdef _OPENMP
+	if(nr_thread > 1)
+	{
+		size_t *pos = new size_t[(size_t)nr_thread*n];
+		x_space = NULL;
+#pragma omp parallel num_threads(nr_thread)
+		{
+			int nt = omp_get_num_threads();
+			int t = omp_get_thread_num();
+			int begin = (int)((long long)l*t/nt);
+			int end = (int)((long long)l*(t+1)/nt);
+			size_t *pos_t = &pos[(size_t)t*n];
+
+			for(int c=0; c<n; c++)
+				pos_t[c] = 0;
+			for(int k=begin; k<end; k++)
+				for(feature_node *x=prob->x[k]; x->index != -1; x++)
+					pos_t[x->index-1]++;
+#pragma omp barrier
+
+			// col_ptr[c+1] holds the count of column c until the prefix sum
+#pragma omp for schedule(static)
+			for(int c=0; c<n; c++)
+			{
+				size_t cnt = 0;
+				for(int u=0; u<nt; u++)
+				{
+					size_t tmp = pos[(size_t)u*n+c];
+					pos[(size_t)u*n+c] = cnt;
+					cnt += tmp;
+				}
+				col_ptr[c+1] = cnt;
+			}
+
+#pragma omp single
+			{
+				col_ptr[0] = 0;
+				for(int c=1; c<n+1; c++)
+				{
+					nnz += col_ptr[c];
+					col_ptr[c] += col_ptr[c-1] + 1;
+				}
+				x_space = new feature_node[nnz+n];
+			}
+
+			for(int k=begin; k<end; k++)
+				for(feature_node *x=prob->x[k]; x->index != -1; x++)
+				{
+					int ind = x->index-1;
+					feature_node *node = &x_space[col_ptr[ind] + pos_t[ind]++];
+					node->index = k+1; // starts from 1
+					node->value = x->value;
+				}
+
+#pragma omp for schedule(static)
+			for(int c=0; c<n; c++)
+			{
+				prob_col->x[c] = &x_space[col_ptr[c]];
+				x_space[col_ptr[c+1]-1].index = -1;
+			}
+		}
+		delete [] pos;
+
+		*x_space_ret = x_space;
+		delete [] col_ptr;
+		return;
+	}
+#else
+	(void)nr_thread;
+#endif
+
 	for(i=0; i<n+1; i++)
 		col_ptr[i] = 0;
 	for(i=0; i<l; i++)
@@ -2538,6 +3815,125 @@ static void transpose(const problem *prob, feature_node **x_space_ret, problem *
 	delete [] col_ptr;
 }
 
+// Bytes of the column format made by transpose for nnz nonzeros, and of the
+// counts it frees on return
+static size_t transpose_bytes(int l, int n, size_t nnz)
+{
+	return sizeof(double)*(size_t)l + sizeof(feature_node *)*(size_t)n + sizeof(feature_node)*(nnz+n);
+}
+
+static size_t transpose_count_bytes(int n, int nr_thread)
+{
+	size_t bytes = sizeof(size_t)*((size_t)n+1);
+#ifdef _OPENMP
+	if(nr_thread > 1)
+		bytes += sizeof(size_t)*(size_t)nr_thread*n;
+#else
+	(void)nr_thread;
+#endif
+	return bytes;
+}
+
+// Workspace of a training run, which also keeps the column format of the
+// data for the L1-regularized solvers. The calls of train_one on the same
+// rows (the classes of one-vs-rest, the values of C) share one transpose;
+// only the labels are copied again.
+class train_workspace : public workspace
+{
+public:
+	train_workspace();
+	~train_workspace();
+
+	const problem *get_prob_col(const problem *prob, int nr_thread);
+
+private:
+	void free_prob_col();
+
+	problem prob_col;
+	feature_node *x_space;
+	feature_node **rows; // rows transposed into prob_col
+	size_t prob_col_bytes;
+};
+
+train_workspace::train_workspace()
+{
+	prob_col.l = 0;
+	prob_col.n = 0;
+	prob_col.y = NULL;
+	prob_col.x = NULL;
+	x_space = NULL;
+	rows = NULL;
+	prob_col_bytes = 0;
+}
+
+train_workspace::~train_workspace()
+{
+	free_prob_col();
+}
+
+void train_workspace::free_prob_col()
+{
+	delete [] prob_col.y;
+	delete [] prob_col.x;
+	delete [] x_space;
+	delete [] rows;
+	prob_col.y = NULL;
+	prob_col.x = NULL;
+	x_space = NULL;
+	rows = NULL;
+	mem_free(prob_col_bytes);
+	prob_col_bytes = 0;
+}
+
+const problem *train_workspace::get_prob_col(const problem *prob, int nr_thread)
+{
+	int l = prob->l;
+	bool same = rows != NULL && prob_col.l == l && prob_col.n == prob->n;
+	for(int i=0; same && i<l; i++)
+		same = rows[i] == prob->x[i];
+
+	if(same)
+	{
+		for(int i=0; i<l; i++)
+			prob_col.y[i] = prob->y[i];
+	}
+	else
+	{
+		free_prob_col();
+		int phase = set_mem_phase(MEM_TRANSPOSE);
+		transpose(prob, &x_space, &prob_col, nr_thread);
+		// the nodes end with the last column; the counts of transpose
+		// were alive with the columns
+		int n = prob->n;
+		size_t nr_node = 0;
+		if(n > 0)
+		{
+			feature_node *end = prob_col.x[n-1];
+			while(end->index != -1)
+				end++;
+			nr_node = end - x_space + 1;
+		}
+		size_t counts = transpose_count_bytes(n, nr_thread);
+		prob_col_bytes = transpose_bytes(l, n, nr_node - n);
+		mem_alloc(prob_col_bytes + counts);
+		mem_free(counts);
+		clone(rows, prob->x, l);
+		prob_col_bytes += sizeof(feature_node *)*(size_t)l;
+		mem_alloc(sizeof(feature_node *)*(size_t)l);
+		set_mem_phase(phase);
+	}
+	return &prob_col;
+}
+
+// mixes all the bits of a label into the low ones, which index the slots
+static unsigned int hash_label(int label)
+{
+	unsigned int h = (unsigned int)label;
+	h = (h ^ (h >> 16))*0x45d9f3bU;
+	h = (h ^ (h >> 16))*0x45d9f3bU;
+	return h ^ (h >> 16);
+}
+
 // label: label name, start: begin of each class, count: #data of classes, perm: indices to the original data
 // perm, length l, must be allocated before calling this subroutine
 static void group_classes(const problem *prob, int *nr_class_ret, int **label_ret, int **start_ret, int **count_ret, int *perm)
@@ -2550,21 +3946,26 @@ static void group_classes(const problem *prob, int *nr_class_ret, int **label_re
 	int *data_label = Malloc(int,l);
 	int i;
 
+	// open addressing from the label to its index, with at least twice as
+	// many slots as classes, so that the grouping takes O(l) for any
+	// number of classes
+	int nr_slot = 2*max_nr_class;
+	int *slot = Malloc(int,nr_slot);
+	for(i=0;i<nr_slot;i++)
+		slot[i] = -1;
+
 	for(i=0;i<l;i++)
 	{
 		int this_label = (int)prob->y[i];
+		int h = (int)(hash_label(this_label) & (nr_slot-1));
 		int j;
-		for(j=0;j<nr_class;j++)
-		{
-			if(this_label == label[j])
-			{
-				++count[j];
-				break;
-			}
-		}
-		data_label[i] = j;
-		if(j == nr_class)
+		while((j = slot[h]) != -1 && label[j] != this_label)
+			h = (h+1) & (nr_slot-1);
+		if(j != -1)
+			++count[j];
+		else
 		{
+			j = nr_class;
 			if(nr_class == max_nr_class)
 			{
 				max_nr_class *= 2;
@@ -2574,8 +3975,29 @@ static void group_classes(const problem *prob, int *nr_class_ret, int **label_re
 			label[nr_class] = this_label;
 			count[nr_class] = 1;
 			++nr_class;
+
+			if(2*nr_class > nr_slot)
+			{
+				nr_slot *= 2;
+				free(slot);
+				slot = Malloc(int,nr_slot);
+				int k;
+				for(k=0;k<nr_slot;k++)
+					slot[k] = -1;
+				for(k=0;k<nr_class;k++)
+				{
+					h = (int)(hash_label(label[k]) & (nr_slot-1));
+					while(slot[h] != -1)
+						h = (h+1) & (nr_slot-1);
+					slot[h] = k;
+				}
+			}
+			else
+				slot[h] = j;
 		}
+		data_label[i] = j;
 	}
+	free(slot);
 
 	//
 	// Labels are ordered by their first occurrence in the training set.
@@ -2615,18 +4037,83 @@ static void group_classes(const problem *prob, int *nr_class_ret, int **label_re
 	free(data_label);
 }
 
-static void train_one(const problem *prob, const parameter *param, double *w, double Cp, double Cn)
+// col[i] receives the rank of label[i] among the nr_class distinct labels,
+// the column of the class in the layouts ordered by label
+static void rank_labels(const int *label, int nr_class, int *col)
+{
+	feature_node *sorted = Malloc(feature_node, nr_class);
+	for(int i=0; i<nr_class; i++)
+	{
+		sorted[i].index = i;
+		sorted[i].value = label[i];
+	}
+	qsort(sorted, nr_class, sizeof(feature_node), compare_feature_node);
+	for(int i=0; i<nr_class; i++)
+		col[sorted[i].index] = i;
+	free(sorted);
+}
+
+// Rows of the subproblem of class pos in one-vs-rest with param->neg_ratio:
+// all of class pos and ceil(neg_ratio*count[pos]) of the others, which every
+// other class gives in proportion to its size, give or take one (systematic
+// allocation from a random offset), and picks at random (selection
+// sampling). index receives the rows in the order of the classes. Returns
+// their number, or l if all the rows are kept.
+static int sample_negatives(int l, const int *start, const int *count, int nr_class, int pos, double neg_ratio, int *index)
+{
+	long long nr_neg = l - count[pos];
+	if(neg_ratio*count[pos] >= nr_neg)
+		return l;
+	long long nr_keep = (long long)ceil(neg_ratio*count[pos]);
+	long long offset = (long long)(nr_neg*(rand()/((double)RAND_MAX+1)));
+	long long seen = 0;	// negatives in the classes before j
+	int nr_index = 0;
+	for(int j=0; j<nr_class; j++)
+	{
+		int s = start[j];
+		int e = s+count[j];
+		if(j == pos)
+		{
+			for(int k=s; k<e; k++)
+				index[nr_index++] = k;
+			continue;
+		}
+		int need = (int)(((seen+count[j])*nr_keep+offset)/nr_neg - (seen*nr_keep+offset)/nr_neg);
+		seen += count[j];
+		for(int k=s; k<e && need>0; k++)
+			if((e-k)*(rand()/((double)RAND_MAX+1)) < need)
+			{
+				index[nr_index++] = k;
+				need--;
+			}
+	}
+	return nr_index;
+}
+
+// alpha, if not NULL, holds the initial dual variables of the samples for
+// the dual solvers, and receives their solution; otherwise they start from 0
+static void train_one(const problem *prob, const parameter *param, double *w, double Cp, double Cn, train_workspace *ws, double *alpha = NULL)
 {
 	int solver_type = param->solver_type;
 	int dual_solver_max_iter = 300;
 	int iter;
 
+	if(ws->stat)
+		ws->stat->nr_solve++;
+	ws->set_mem_phase(MEM_SOLVE);
+	if(alpha == NULL)
+	{
+		alpha = ws->get<double>(WS_ALPHA, prob->l);
+		for(int i=0;i<prob->l;i++)
+			alpha[i] = 0;
+	}
+
 	bool is_regression = (solver_type==L2R_L2LOSS_SVR ||
 				solver_type==L2R_L1LOSS_SVR_DUAL ||
 				solver_type==L2R_L2LOSS_SVR_DUAL);
 
 	// Some solvers use Cp,Cn but not C array; extensions possible but no plan for now
-	double *C = new double[prob->l];
+	double *C = ws->get<double>(WS_C, prob->l);
 	double primal_solver_tol = param->eps;
 	if(is_regression)
 	{
@@ -2654,7 +4141,7 @@ static void train_one(const problem *prob, const parameter *param, double *w, do
 	{
 		case L2R_LR:
 		{
-			l2r_lr_fun fun_obj(prob, param, C);
+			l2r_lr_fun fun_obj(prob, param, C, ws);
 			NEWTON newton_obj(&fun_obj, primal_solver_tol);
 			newton_obj.set_print_string(liblinear_print_string);
 			newton_obj.newton(w);
@@ -2662,7 +4149,7 @@ static void train_one(const problem *prob, const parameter *param, double *w, do
 		}
 		case L2R_L2LOSS_SVC:
 		{
-			l2r_l2_svc_fun fun_obj(prob, param, C);
+			l2r_l2_svc_fun fun_obj(prob, param, C, ws);
 			NEWTON newton_obj(&fun_obj, primal_solver_tol);
 			newton_obj.set_print_string(liblinear_print_string);
 			newton_obj.newton(w);
@@ -2670,13 +4157,13 @@ static void train_one(const problem *prob, const parameter *param, double *w, do
 		}
 		case L2R_L2LOSS_SVC_DUAL:
 		{
-			iter = solve_l2r_l1l2_svc(prob, param, w, Cp, Cn, dual_solver_max_iter);
+			iter = solve_l2r_l1l2_svc(prob, param, w, alpha, Cp, Cn, ws, dual_solver_max_iter);
 			if(iter >= dual_solver_max_iter)
 			{
 				info("\nWARNING: reaching max number of iterations\nSwitching to use -s 2\n\n");
 				// primal_solver_tol obtained from eps for dual may be too loose
 				primal_solver_tol *= 0.1;
-				l2r_l2_svc_fun fun_obj(prob, param, C);
+				l2r_l2_svc_fun fun_obj(prob, param, C, ws);
 				NEWTON newton_obj(&fun_obj, primal_solver_tol);
 				newton_obj.set_print_string(liblinear_print_string);
 				newton_obj.newton(w);
@@ -2685,42 +4172,32 @@ static void train_one(const problem *prob, const parameter *param, double *w, do
 		}
 		case L2R_L1LOSS_SVC_DUAL:
 		{
-			iter = solve_l2r_l1l2_svc(prob, param, w, Cp, Cn, dual_solver_max_iter);
+			iter = solve_l2r_l1l2_svc(prob, param, w, alpha, Cp, Cn, ws, dual_solver_max_iter);
 			if(iter >= dual_solver_max_iter)
 				info("\nWARNING: reaching max number of iterations\nUsing -s 2 may be faster (also see FAQ)\n\n");			
 			break;
 		}
 		case L1R_L2LOSS_SVC:
 		{
-			problem prob_col;
-			feature_node *x_space = NULL;
-			transpose(prob, &x_space ,&prob_col);
-			solve_l1r_l2_svc(&prob_col, param, w, Cp, Cn, primal_solver_tol);
-			delete [] prob_col.y;
-			delete [] prob_col.x;
-			delete [] x_space;
+			const problem *prob_col = ws->get_prob_col(prob, param->nr_thread);
+			solve_l1r_l2_svc(prob_col, param, w, Cp, Cn, primal_solver_tol, ws);
 			break;
 		}
 		case L1R_LR:
 		{
-			problem prob_col;
-			feature_node *x_space = NULL;
-			transpose(prob, &x_space ,&prob_col);
-			solve_l1r_lr(&prob_col, param, w, Cp, Cn, primal_solver_tol);
-			delete [] prob_col.y;
-			delete [] prob_col.x;
-			delete [] x_space;
+			const problem *prob_col = ws->get_prob_col(prob, param->nr_thread);
+			solve_l1r_lr(prob_col, param, w, Cp, Cn, primal_solver_tol, ws);
 			break;
 		}
 		case L2R_LR_DUAL:
 		{
-			iter = solve_l2r_lr_dual(prob, param, w, Cp, Cn, dual_solver_max_iter);
+			iter = solve_l2r_lr_dual(prob, param, w, alpha, Cp, Cn, ws, dual_solver_max_iter);
 			if(iter >= dual_solver_max_iter)
 			{
 				info("\nWARNING: reaching max number of iterations\nSwitching to use -s 0\n\n");
 				// primal_solver_tol obtained from eps for dual may be too loose
 				primal_solver_tol *= 0.1;
-				l2r_lr_fun fun_obj(prob, param, C);
+				l2r_lr_fun fun_obj(prob, param, C, ws);
 				NEWTON newton_obj(&fun_obj, primal_solver_tol);
 				newton_obj.set_print_string(liblinear_print_string);
 				newton_obj.newton(w);
@@ -2729,7 +4206,7 @@ static void train_one(const problem *prob, const parameter *param, double *w, do
 		}
 		case L2R_L2LOSS_SVR:
 		{
-			l2r_l2_svr_fun fun_obj(prob, param, C);
+			l2r_l2_svr_fun fun_obj(prob, param, C, ws);
 			NEWTON newton_obj(&fun_obj, primal_solver_tol);
 			newton_obj.set_print_string(liblinear_print_string);
 			newton_obj.newton(w);
@@ -2737,7 +4214,7 @@ static void train_one(const problem *prob, const parameter *param, double *w, do
 		}
 		case L2R_L1LOSS_SVR_DUAL:
 		{
-			iter = solve_l2r_l1l2_svr(prob, param, w, dual_solver_max_iter);
+			iter = solve_l2r_l1l2_svr(prob, param, w, alpha, ws, dual_solver_max_iter);
 			if(iter >= dual_solver_max_iter)
 				info("\nWARNING: reaching max number of iterations\nUsing -s 11 may be faster (also see FAQ)\n\n");			
 
@@ -2745,13 +4222,13 @@ static void train_one(const problem *prob, const parameter *param, double *w, do
 		}
 		case L2R_L2LOSS_SVR_DUAL:
 		{
-			iter = solve_l2r_l1l2_svr(prob, param, w, dual_solver_max_iter);
+			iter = solve_l2r_l1l2_svr(prob, param, w, alpha, ws, dual_solver_max_iter);
 			if(iter >= dual_solver_max_iter)
 			{
 				info("\nWARNING: reaching max number of iterations\nSwitching to use -s 11\n\n");
 				// primal_solver_tol obtained from eps for dual may be too loose
 				primal_solver_tol *= 0.001;
-				l2r_l2_svr_fun fun_obj(prob, param, C);
+				l2r_l2_svr_fun fun_obj(prob, param, C, ws);
 				NEWTON newton_obj(&fun_obj, primal_solver_tol);
 				newton_obj.set_print_string(liblinear_print_string);
 				newton_obj.newton(w);
@@ -2762,8 +4239,6 @@ static void train_one(const problem *prob, const parameter *param, double *w, do
 			fprintf(stderr, "ERROR: unknown solver_type\n");
 			break;
 	}
-
-	delete[] C;
 }
 
 // Calculate the initial C for parameter selection
@@ -2821,7 +4296,9 @@ static double calc_max_p(const problem *prob)
 	return max_p;
 }
 
-static void find_parameter_C(const problem *prob, parameter *param_tmp, double start_C, double max_C, double *best_C, double *best_score, const int *fold_start, const int *perm, const problem *subprob, int nr_fold)
+static model* train_with_workspace(const problem *prob, const parameter *param, train_workspace *ws, double *alpha = NULL, const double *xTx = NULL);
+
+static void find_parameter_C(const problem *prob, parameter *param_tmp, double start_C, double max_C, double *best_C, double *best_score, const int *fold_start, const int *perm, const problem *subprob, int nr_fold, train_workspace *ws)
 {
 	// variables for CV
 	int i;
@@ -2854,7 +4331,7 @@ static void find_parameter_C(const problem *prob, parameter *param_tmp, double s
 			int end = fold_start[i+1];
 
 			param_tmp->init_sol = prev_w[i];
-			struct model *submodel = train(&subprob[i],param_tmp);
+			struct model *submodel = train_with_workspace(&subprob[i], param_tmp, ws);
 
 			int total_w_size;
 			if(submodel->nr_class == 2)
@@ -2894,6 +4371,13 @@ static void find_parameter_C(const problem *prob, parameter *param_tmp, double s
 		}
 		set_print_string_function(default_print_string);
 
+		// the folds may have been cut by the time limit, so this C is not scored
+		if(ws->time_is_up())
+		{
+			info("WARNING: reaching time limit\n");
+			break;
+		}
+
 		if(param_tmp->solver_type == L2R_LR || param_tmp->solver_type == L2R_L2LOSS_SVC)
 		{
 			int total_correct = 0;
@@ -2943,10 +4427,130 @@ static void find_parameter_C(const problem *prob, parameter *param_tmp, double s
 }
 
 
+// The dual variables of a training in train_with_workspace: those of the
+// caller if given, or a new array holding param->init_alpha (or 0) if the
+// training starts from them or keeps them, or NULL.
+static double *get_train_alpha(const parameter *param, double *alpha, int size)
+{
+	if(alpha != NULL || (param->init_alpha == NULL && !param->keep_alpha))
+		return alpha;
+
+	double *train_alpha = Malloc(double, size);
+	for(int i=0; i<size; i++)
+		train_alpha[i] = param->init_alpha != NULL ? param->init_alpha[i] : 0;
+	return train_alpha;
+}
+
+// With param->keep_alpha, the model takes the dual variables, or a copy of
+// those owned by the caller; otherwise an array of get_train_alpha is freed.
+static void keep_train_alpha(model *model_, const parameter *param, double *train_alpha, double *alpha, int size)
+{
+	if(param->keep_alpha)
+	{
+		if(train_alpha == alpha)
+		{
+			model_->alpha = Malloc(double, size);
+			memcpy(model_->alpha, alpha, sizeof(double)*size);
+		}
+		else
+			model_->alpha = train_alpha;
+		model_->nr_alpha = size;
+	}
+	else if(train_alpha != alpha)
+		free(train_alpha);
+}
+
+// Counts an array of train_with_workspace in ws, and in *mem, the bytes
+// it returns to ws at the end
+static void count_bytes(workspace *ws, size_t *mem, size_t bytes)
+{
+	ws->mem_alloc(bytes);
+	*mem += bytes;
+}
+
+// Whether the solver takes the squared norms of the rows from ws->xTx
+static bool uses_row_norms(int solver_type)
+{
+	return solver_type == L2R_L2LOSS_SVC_DUAL || solver_type == L2R_L1LOSS_SVC_DUAL ||
+		solver_type == MCSVM_CS || solver_type == L2R_LR_DUAL ||
+		solver_type == L2R_L2LOSS_SVR_DUAL || solver_type == L2R_L1LOSS_SVR_DUAL ||
+		solver_type == ONECLASS_SVM;
+}
+
+// The squared norms of the rows of prob, which the caller frees
+static double *row_norms(const problem *prob)
+{
+	double *xTx = Malloc(double, prob->l);
+	for(int i=0; i<prob->l; i++)
+		xTx[i] = sparse_operator::nrm2_sq(prob->x[i]);
+	return xTx;
+}
+
+// Whether the rows of a classification problem are copied in the order of
+// the classes. The L1-regularized solvers work on the column format, whose
+// cache in train_workspace is kept while the row pointers stay the same.
+static bool uses_row_layout(int solver_type)
+{
+	return solver_type != L1R_L2LOSS_SVC && solver_type != L1R_LR;
+}
+
+// Sets x[i] to the row prob->x[perm[i]]. If copy is true and the rows are
+// not already one after another in that order, they are copied into one
+// array, so that the passes of the solvers over x read the nodes in order
+// instead of following the rows of the caller around the heap. Returns the
+// array, which the caller frees, or NULL; *nr_node receives its length.
+static feature_node *layout_rows(const problem *prob, const int *perm, bool copy, feature_node **x, size_t *nr_node)
+{
+	int l = prob->l;
+	size_t total = 0;
+	bool in_order = true;
+	for(int i=0; i<l; i++)
+	{
+		const feature_node *xi = prob->x[perm[i]];
+		const feature_node *end = xi;
+		while(end->index != -1)
+			end++;
+		end++;
+		if(i+1 < l && end != prob->x[perm[i+1]])
+			in_order = false;
+		total += end - xi;
+		x[i] = prob->x[perm[i]];
+	}
+
+	*nr_node = 0;
+	if(!copy || in_order)
+		return NULL;
+
+	feature_node *x_space = Malloc(feature_node, total);
+	feature_node *node = x_space;
+	for(int i=0; i<l; i++)
+	{
+		const feature_node *xi = x[i];
+		x[i] = node;
+		while(xi->index != -1)
+			*node++ = *xi++;
+		*node++ = *xi;
+	}
+	*nr_node = total;
+	return x_space;
+}
+
+// train() with the scratch arrays of the solvers taken from ws, so that
+// consecutive calls on problems of similar sizes reuse them
 //
-// Interface functions
+// alpha, if not NULL, holds the dual variables of the dual solvers
+// (-s 1, 3, 7, 12, 13) in the layout of w: alpha[i*nr_col+k] for sample i
+// and the k-th of the nr_col binary problems (1 for two classes and
+// regression). For more than two classes, column k belongs to the k-th
+// smallest label, so that the layout does not depend on the order in which
+// the labels appear in prob->y. They are the initial values and receive
+// the solution.
 //
-model* train(const problem *prob, const parameter *param)
+// xTx, if not NULL, holds the squared norms of the rows of prob, so that a
+// caller training on the same rows several times computes them once.
+// Otherwise they are computed here for the dual solvers, and shared by the
+// solver calls of all classes.
+static model* train_with_workspace(const problem *prob, const parameter *param, train_workspace *ws, double *alpha, const double *xTx)
 {
 	int i,j;
 	int l = prob->l;
@@ -2960,6 +4564,29 @@ model* train(const problem *prob, const parameter *param)
 		model_->nr_feature=n;
 	model_->param = *param;
 	model_->bias = prob->bias;
+	model_->alpha = NULL;
+	model_->nr_alpha = 0;
+	model_->stat = NULL;
+	ws->clear_stopped();
+
+	double start_time = workspace::now();
+	if(param->keep_stat)
+	{
+		model_->stat = Malloc(train_stat, 1);
+		memset(model_->stat, 0, sizeof(train_stat));
+	}
+	ws->stat = model_->stat;
+	// bytes of the arrays below, counted in ws until the return
+	size_t mem = 0;
+	ws->set_mem_phase(MEM_SETUP);
+
+	double *prob_xTx = NULL;
+	if(xTx == NULL && uses_row_norms(param->solver_type))
+	{
+		prob_xTx = row_norms(prob);
+		count_bytes(ws, &mem, sizeof(double)*l);
+		xTx = prob_xTx;
+	}
 
 	if(check_regression_model(model_))
 	{
@@ -2974,14 +4601,25 @@ model* train(const problem *prob, const parameter *param)
 
 		model_->nr_class = 2;
 		model_->label = NULL;
-		train_one(prob, param, model_->w, 0, 0);
+		double *train_alpha = get_train_alpha(param, alpha, l);
+		count_bytes(ws, &mem, sizeof(double)*(w_size + (train_alpha != alpha ? l : 0)));
+		ws->xTx = xTx;
+		train_one(prob, param, model_->w, 0, 0, ws, train_alpha);
+		keep_train_alpha(model_, param, train_alpha, alpha, l);
+		if(param->keep_alpha && train_alpha == alpha)
+			count_bytes(ws, &mem, sizeof(double)*l);
 	}
 	else if(check_oneclass_model(model_))
 	{
 		model_->w = Malloc(double, w_size);
 		model_->nr_class = 2;
 		model_->label = NULL;
-		solve_oneclass_svm(prob, param, model_->w, &(model_->rho));
+		count_bytes(ws, &mem, sizeof(double)*w_size);
+		ws->set_mem_phase(MEM_SOLVE);
+		if(ws->stat)
+			ws->stat->nr_solve++;
+		ws->xTx = xTx;
+		solve_oneclass_svm(prob, param, model_->w, &(model_->rho), ws);
 	}
 	else
 	{
@@ -3014,11 +4652,7 @@ model* train(const problem *prob, const parameter *param)
 				weighted_C[j] *= param->weight[i];
 		}
 
-		// constructing the subproblem
-		feature_node **x = Malloc(feature_node *,l);
-		for(i=0;i<l;i++)
-			x[i] = prob->x[perm[i]];
-
+		// constructing the subproblem, with the rows of each class together
 		int k;
 		problem sub_prob;
 		sub_prob.l = l;
@@ -3026,8 +4660,16 @@ model* train(const problem *prob, const parameter *param)
 		sub_prob.x = Malloc(feature_node *,sub_prob.l);
 		sub_prob.y = Malloc(double,sub_prob.l);
 
-		for(k=0; k<sub_prob.l; k++)
-			sub_prob.x[k] = x[k];
+		size_t nr_node;
+		feature_node *x_space = layout_rows(prob, perm, uses_row_layout(param->solver_type), sub_prob.x, &nr_node);
+		count_bytes(ws, &mem, (sizeof(int)+sizeof(feature_node *)+sizeof(double))*l + sizeof(feature_node)*nr_node);
+		if(xTx != NULL)
+		{
+			double *sub_xTx = ws->get<double>(WS_XTX, l);
+			for(k=0; k<l; k++)
+				sub_xTx[k] = xTx[perm[k]];
+			ws->xTx = sub_xTx;
+		}
 
 		// multi-class svm by Crammer and Singer
 		if(param->solver_type == MCSVM_CS)
@@ -3037,13 +4679,23 @@ model* train(const problem *prob, const parameter *param)
 				for(j=start[i];j<start[i]+count[i];j++)
 					sub_prob.y[j] = i;
 			Solver_MCSVM_CS Solver(&sub_prob, nr_class, weighted_C, param->eps);
-			Solver.Solve(model_->w);
+			count_bytes(ws, &mem, sizeof(double)*n*nr_class);
+			ws->set_mem_phase(MEM_SOLVE);
+			if(ws->stat)
+				ws->stat->nr_solve++;
+			Solver.Solve(model_->w, ws);
 		}
 		else
 		{
+			int nr_col = nr_class == 2 ? 1 : nr_class;
+			double *train_alpha = get_train_alpha(param, alpha, l*nr_col);
+			if(train_alpha != alpha)
+				count_bytes(ws, &mem, sizeof(double)*l*nr_col);
+
 			if(nr_class == 2)
 			{
 				model_->w=Malloc(double, w_size);
+				count_bytes(ws, &mem, sizeof(double)*w_size);
 
 				int e0 = start[0]+count[0];
 				k=0;
@@ -3059,12 +4711,27 @@ model* train(const problem *prob, const parameter *param)
 					for(i=0;i<w_size;i++)
 						model_->w[i] = 0;
 
-				train_one(&sub_prob, param, model_->w, weighted_C[0], weighted_C[1]);
+				double *alpha_sub = NULL;
+				if(train_alpha != NULL)
+				{
+					alpha_sub = ws->get<double>(WS_ALPHA, l);
+					for(k=0; k<l; k++)
+						alpha_sub[k] = train_alpha[perm[k]];
+				}
+
+				train_one(&sub_prob, param, model_->w, weighted_C[0], weighted_C[1], ws, alpha_sub);
+
+				if(train_alpha != NULL)
+					for(k=0; k<l; k++)
+						train_alpha[perm[k]] = alpha_sub[k];
 			}
 			else
 			{
 				model_->w=Malloc(double, w_size*nr_class);
 				double *w=Malloc(double, w_size);
+				count_bytes(ws, &mem, sizeof(double)*w_size*(nr_class+1));
+				int *col=Malloc(int, nr_class);
+				rank_labels(label, nr_class, col);
 				for(i=0;i<nr_class;i++)
 				{
 					int si = start[i];
@@ -3085,17 +4752,72 @@ model* train(const problem *prob, const parameter *param)
 						for(j=0;j<w_size;j++)
 							w[j] = 0;
 
-					train_one(&sub_prob, param, w, weighted_C[i], param->C);
+					// with param->neg_ratio, a sample of the negatives, whose C
+					// is raised by the inverse of the fraction kept
+					problem neg_prob = sub_prob;
+					int *index = NULL;
+					double Cn = param->C;
+					const double *sub_xTx = ws->xTx;
+					if(param->neg_ratio > 0)
+					{
+						index = ws->get<int>(WS_NEG_INDEX, l);
+						neg_prob.l = sample_negatives(l, start, count, nr_class, i, param->neg_ratio, index);
+						if(neg_prob.l < l)
+						{
+							neg_prob.x = ws->get<feature_node *>(WS_NEG_X, neg_prob.l);
+							neg_prob.y = ws->get<double>(WS_NEG_Y, neg_prob.l);
+							for(k=0; k<neg_prob.l; k++)
+							{
+								neg_prob.x[k] = sub_prob.x[index[k]];
+								neg_prob.y[k] = sub_prob.y[index[k]];
+							}
+							if(sub_xTx != NULL)
+							{
+								double *neg_xTx = ws->get<double>(WS_NEG_XTX, neg_prob.l);
+								for(k=0; k<neg_prob.l; k++)
+									neg_xTx[k] = sub_xTx[index[k]];
+								ws->xTx = neg_xTx;
+							}
+							Cn *= (double)(l-count[i])/(neg_prob.l-count[i]);
+						}
+						else
+							index = NULL;
+					}
+
+					// the dual variables of the rows left out are 0
+					double *alpha_sub = NULL;
+					if(train_alpha != NULL)
+					{
+						alpha_sub = ws->get<double>(WS_ALPHA, l);
+						for(k=0; k<neg_prob.l; k++)
+							alpha_sub[k] = train_alpha[perm[index ? index[k] : k]*nr_class+col[i]];
+					}
+
+					train_one(&neg_prob, param, w, weighted_C[i], Cn, ws, alpha_sub);
+
+					if(train_alpha != NULL)
+					{
+						if(index != NULL)
+							for(k=0; k<l; k++)
+								train_alpha[perm[k]*nr_class+col[i]] = 0;
+						for(k=0; k<neg_prob.l; k++)
+							train_alpha[perm[index ? index[k] : k]*nr_class+col[i]] = alpha_sub[k];
+					}
+					ws->xTx = sub_xTx;
 
 					for(j=0;j<w_size;j++)
 						model_->w[j*nr_class+i] = w[j];
 				}
 				free(w);
+				free(col);
 			}
 
+			keep_train_alpha(model_, param, train_alpha, alpha, l*nr_col);
+			if(param->keep_alpha && train_alpha == alpha)
+				count_bytes(ws, &mem, sizeof(double)*l*nr_col);
 		}
 
-		free(x);
+		free(x_space);
 		free(label);
 		free(start);
 		free(count);
@@ -3104,15 +4826,118 @@ model* train(const problem *prob, const parameter *param)
 		free(sub_prob.y);
 		free(weighted_C);
 	}
+	ws->xTx = NULL;
+	free(prob_xTx);
+	ws->mem_free(mem);
+	model_->stopped_early = ws->stopped();
+	if(ws->stat)
+	{
+		ws->stat->time = workspace::now() - start_time;
+		ws->stat = NULL;
+	}
 	return model_;
 }
 
-void cross_validation(const problem *prob, const parameter *param, int nr_fold, double *target)
+//
+// Interface functions
+//
+model* train(const problem *prob, const parameter *param)
+{
+	train_workspace ws;
+	ws.set_time_limit(param->max_time);
+	return train_with_workspace(prob, param, &ws);
+}
+
+void train_path(const problem *prob, const parameter *param, int nr_C, const double *C, model **models)
+{
+	int i, k;
+	int l = prob->l;
+	int solver_type = param->solver_type;
+	parameter param_tmp = *param;
+	train_workspace ws;
+	// param->max_time limits the whole path; the models after the time is up
+	// are left after one iteration from the previous ones
+	ws.set_time_limit(param->max_time);
+
+	// the primal solvers start from the previous w, and the dual solvers
+	// from the previous alpha scaled by the ratio of C
+	bool is_primal = (solver_type == L2R_LR || solver_type == L2R_L2LOSS_SVC ||
+				solver_type == L2R_L2LOSS_SVR || solver_type == L1R_L2LOSS_SVC ||
+				solver_type == L1R_LR);
+	bool is_dual = (solver_type == L2R_L2LOSS_SVC_DUAL || solver_type == L2R_L1LOSS_SVC_DUAL ||
+				solver_type == L2R_LR_DUAL || solver_type == L2R_L2LOSS_SVR_DUAL ||
+				solver_type == L2R_L1LOSS_SVR_DUAL);
+
+	double *alpha = NULL;
+	int nr_col = 1;
+	if(is_dual)
+	{
+		if(solver_type != L2R_L2LOSS_SVR_DUAL && solver_type != L2R_L1LOSS_SVR_DUAL)
+		{
+			int nr_class;
+			int *label = NULL;
+			int *start = NULL;
+			int *count = NULL;
+			int *perm = Malloc(int,l);
+			group_classes(prob,&nr_class,&label,&start,&count,perm);
+			if(nr_class > 2)
+				nr_col = nr_class;
+			free(label);
+			free(start);
+			free(count);
+			free(perm);
+		}
+		alpha = Malloc(double, (size_t)l*nr_col);
+		ws.mem_alloc(sizeof(double)*l*nr_col);
+		for(i=0; i<l*nr_col; i++)
+			alpha[i] = param->init_alpha != NULL ? param->init_alpha[i] : 0;
+		param_tmp.init_alpha = NULL;
+	}
+
+	// the rows are the same at every C
+	double *xTx = NULL;
+	if(uses_row_norms(solver_type))
+	{
+		xTx = row_norms(prob);
+		ws.mem_alloc(sizeof(double)*l);
+	}
+
+	for(k=0; k<nr_C; k++)
+	{
+		param_tmp.C = C[k];
+		if(k > 0)
+		{
+			if(is_primal)
+				param_tmp.init_sol = models[k-1]->w;
+			if(is_dual)
+			{
+				double ratio = C[k]/C[k-1];
+				for(i=0; i<l*nr_col; i++)
+					alpha[i] *= ratio;
+			}
+		}
+		models[k] = train_with_workspace(prob, &param_tmp, &ws, alpha, xTx);
+		models[k]->param.init_sol = NULL;
+		models[k]->param.init_alpha = NULL;
+	}
+
+	free(alpha);
+	free(xTx);
+}
+
+void cross_validation(const problem *prob, const parameter *param, int nr_fold, double *target)
 {
 	int i;
 	int *fold_start;
 	int l = prob->l;
 	int *perm = Malloc(int,l);
+	train_workspace ws;
+	// the dual variables of the whole data do not apply to the folds
+	parameter param_fold = *param;
+	param_fold.init_alpha = NULL;
+	param_fold.keep_alpha = false;
+	param_fold.keep_stat = false;
+	ws.set_time_limit(param->max_time);
 	if (nr_fold > l)
 	{
 		nr_fold = l;
@@ -3128,6 +4953,16 @@ void cross_validation(const problem *prob, const parameter *param, int nr_fold,
 	for(i=0;i<=nr_fold;i++)
 		fold_start[i]=i*l/nr_fold;
 
+	// the norms of the rows of all folds, computed once
+	double *xTx = NULL;
+	double *subprob_xTx = NULL;
+	if(uses_row_norms(param->solver_type))
+	{
+		xTx = row_norms(prob);
+		subprob_xTx = Malloc(double,l);
+		ws.mem_alloc(2*sizeof(double)*l);
+	}
+
 	for(i=0;i<nr_fold;i++)
 	{
 		int begin = fold_start[i];
@@ -3154,13 +4989,23 @@ void cross_validation(const problem *prob, const parameter *param, int nr_fold,
 			subprob.y[k] = prob->y[perm[j]];
 			++k;
 		}
-		struct model *submodel = train(&subprob,param);
+		if(xTx != NULL)
+		{
+			k=0;
+			for(j=0;j<begin;j++)
+				subprob_xTx[k++] = xTx[perm[j]];
+			for(j=end;j<l;j++)
+				subprob_xTx[k++] = xTx[perm[j]];
+		}
+		struct model *submodel = train_with_workspace(&subprob, &param_fold, &ws, NULL, subprob_xTx);
 		for(j=begin;j<end;j++)
 			target[perm[j]] = predict(submodel,prob->x[perm[j]]);
 		free_and_destroy_model(&submodel);
 		free(subprob.x);
 		free(subprob.y);
 	}
+	free(xTx);
+	free(subprob_xTx);
 	free(fold_start);
 	free(perm);
 }
@@ -3219,6 +5064,9 @@ void find_parameters(const problem *prob, const parameter *param, int nr_fold, d
 	}
 
 	struct parameter param_tmp = *param;
+	param_tmp.keep_stat = false;
+	train_workspace ws;
+	ws.set_time_limit(param->max_time);
 	*best_p = -1;
 	if(param->solver_type == L2R_LR || param->solver_type == L2R_L2LOSS_SVC)
 	{
@@ -3228,7 +5076,7 @@ void find_parameters(const problem *prob, const parameter *param, int nr_fold, d
 		start_C = min(start_C, max_C);
 		double best_C_tmp, best_score_tmp;
 
-		find_parameter_C(prob, &param_tmp, start_C, max_C, &best_C_tmp, &best_score_tmp, fold_start, perm, subprob, nr_fold);
+		find_parameter_C(prob, &param_tmp, start_C, max_C, &best_C_tmp, &best_score_tmp, fold_start, perm, subprob, nr_fold, &ws);
 
 		*best_C = best_C_tmp;
 		*best_score = best_score_tmp;
@@ -3254,7 +5102,7 @@ void find_parameters(const problem *prob, const parameter *param, int nr_fold, d
 			start_C_tmp = min(start_C_tmp, max_C);
 			double best_C_tmp, best_score_tmp;
 
-			find_parameter_C(prob, &param_tmp, start_C_tmp, max_C, &best_C_tmp, &best_score_tmp, fold_start, perm, subprob, nr_fold);
+			find_parameter_C(prob, &param_tmp, start_C_tmp, max_C, &best_C_tmp, &best_score_tmp, fold_start, perm, subprob, nr_fold, &ws);
 
 			if(best_score_tmp < *best_score)
 			{
@@ -3262,6 +5110,8 @@ void find_parameters(const problem *prob, const parameter *param, int nr_fold, d
 				*best_C = best_C_tmp;
 				*best_score = best_score_tmp;
 			}
+			if(ws.time_is_up())
+				break;
 		}
 	}
 
@@ -3275,6 +5125,628 @@ void find_parameters(const problem *prob, const parameter *param, int nr_fold, d
 	free(subprob);
 }
 
+//
+// Out-of-core training by block minimization (Yu et al., KDD 2010)
+//
+// A block file holds the rows of a problem in blocks, each appended by
+// save_block from a part of the problem that fits in memory:
+//
+//   "LLBK", int l, int n, long long nr_node
+//   double y[l]
+//   feature_node x[nr_node]    the rows in turn, each ending with index -1
+//
+// in the byte order and struct layout of the machine that wrote it.
+//
+// train_blocks keeps w and the dual variables of all rows in memory, and
+// reads one block at a time. An outer iteration runs the dual coordinate
+// descent solver on each block in turn, with the part of w of the other
+// blocks fixed, while a thread reads the next block. The training stops
+// when every block is optimal at the first pass of its solver.
+
+#ifdef _WIN32
+#define fseek64 _fseeki64
+#define ftell64 _ftelli64
+#else
+#define fseek64 fseeko
+#define ftell64 ftello
+#endif
+
+static const char block_magic[4] = {'L', 'L', 'B', 'K'};
+
+// nodes of a row with the terminating one
+static long long row_nr_node(const feature_node *x)
+{
+	const feature_node *end = x;
+	while(end->index != -1)
+		end++;
+	return end - x + 1;
+}
+
+int save_block(const char *block_file_name, const problem *prob)
+{
+	int i;
+	int l = prob->l;
+	long long nr_node = 0;
+	for(i=0; i<l; i++)
+		nr_node += row_nr_node(prob->x[i]);
+
+	FILE *fp = fopen(block_file_name, "ab");
+	if(fp == NULL)
+		return -1;
+
+	fwrite(block_magic, 1, sizeof(block_magic), fp);
+	fwrite(&l, sizeof(int), 1, fp);
+	fwrite(&prob->n, sizeof(int), 1, fp);
+	fwrite(&nr_node, sizeof(long long), 1, fp);
+	fwrite(prob->y, sizeof(double), l, fp);
+	for(i=0; i<l; i++)
+		fwrite(prob->x[i], sizeof(feature_node), row_nr_node(prob->x[i]), fp);
+
+	if (ferror(fp) != 0 || fclose(fp) != 0) return -1;
+	else return 0;
+}
+
+// The headers of a block file and the labels of all rows
+struct block_file
+{
+	FILE *fp;
+	int nr_block;
+	int l, n;               // over all blocks
+	int max_l;
+	long long max_nr_node;
+	int *start;             // first row of each block
+	int *block_l;
+	long long *nr_node;
+	long long *offset;      // of the rows of each block in the file
+	double *y;
+};
+
+static void close_block_file(block_file *bf)
+{
+	if(bf->fp != NULL)
+		fclose(bf->fp);
+	free(bf->start);
+	free(bf->block_l);
+	free(bf->nr_node);
+	free(bf->offset);
+	free(bf->y);
+}
+
+// Reads the headers and the labels; false if the file cannot be read or
+// is not a block file. The file must end right after the rows of its last
+// block, so that a file cut short or with bytes appended is rejected here
+// rather than while training.
+static bool open_block_file(const char *block_file_name, block_file *bf)
+{
+	memset(bf, 0, sizeof(block_file));
+	bf->fp = fopen(block_file_name, "rb");
+	if(bf->fp == NULL)
+		return false;
+
+	long long file_size = -1;
+	if(fseek64(bf->fp, 0, SEEK_END) == 0)
+		file_size = ftell64(bf->fp);
+	if(file_size <= 0 || fseek64(bf->fp, 0, SEEK_SET) != 0)
+	{
+		close_block_file(bf);
+		return false;
+	}
+
+	int max_nr_block = 0;
+	long long pos = 0;
+	const long long header_size = sizeof(block_magic) + 2*sizeof(int) + sizeof(long long);
+	char magic[sizeof(block_magic)];
+	while(pos < file_size)
+	{
+		int l, n;
+		long long nr_node;
+		if(file_size - pos < header_size
+			|| fread(magic, 1, sizeof(magic), bf->fp) != sizeof(magic)
+			|| memcmp(magic, block_magic, sizeof(magic)) != 0
+			|| fread(&l, sizeof(int), 1, bf->fp) != 1
+			|| fread(&n, sizeof(int), 1, bf->fp) != 1
+			|| fread(&nr_node, sizeof(long long), 1, bf->fp) != 1
+			|| l <= 0 || n < 0 || nr_node < l || bf->l > INT_MAX - l
+			|| (file_size - pos - header_size - (long long)sizeof(double)*l)/(long long)sizeof(feature_node) < nr_node)
+			break;
+
+		if(bf->nr_block == max_nr_block)
+		{
+			max_nr_block = max_nr_block > 0 ? 2*max_nr_block : 16;
+			bf->start = (int *)realloc(bf->start, max_nr_block*sizeof(int));
+			bf->block_l = (int *)realloc(bf->block_l, max_nr_block*sizeof(int));
+			bf->nr_node = (long long *)realloc(bf->nr_node, max_nr_block*sizeof(long long));
+			bf->offset = (long long *)realloc(bf->offset, max_nr_block*sizeof(long long));
+		}
+		bf->y = (double *)realloc(bf->y, ((size_t)bf->l+l)*sizeof(double));
+		if(fread(&bf->y[bf->l], sizeof(double), l, bf->fp) != (size_t)l)
+			break;
+
+		pos += header_size + sizeof(double)*l;
+		int b = bf->nr_block++;
+		bf->start[b] = bf->l;
+		bf->block_l[b] = l;
+		bf->nr_node[b] = nr_node;
+		bf->offset[b] = pos;
+		bf->l += l;
+		bf->n = max(bf->n, n);
+		bf->max_l = max(bf->max_l, l);
+		bf->max_nr_node = max(bf->max_nr_node, nr_node);
+
+		pos += sizeof(feature_node)*nr_node;
+		if(fseek64(bf->fp, pos, SEEK_SET) != 0)
+			break;
+	}
+	if(bf->nr_block == 0 || pos != file_size)
+	{
+		close_block_file(bf);
+		return false;
+	}
+	return true;
+}
+
+// Gives the blocks of a block file in turn. Two blocks are held: the one
+// given by get(), and the next one, which a thread reads in the meantime.
+class block_reader
+{
+public:
+	block_reader(const block_file *bf);
+	~block_reader();
+
+	// the block b as a problem of bf->n columns, or NULL if it cannot be read
+	const problem *get(int b);
+
+private:
+	bool read(int b, int slot);
+
+	const block_file *bf;
+	problem block[2];
+	feature_node *x_space[2];
+	int loaded[2];          // block in each slot, or -1
+	std::thread ahead;
+};
+
+block_reader::block_reader(const block_file *bf): bf(bf)
+{
+	for(int slot=0; slot<2; slot++)
+	{
+		block[slot].x = Malloc(feature_node *, bf->max_l);
+		x_space[slot] = Malloc(feature_node, bf->max_nr_node);
+		loaded[slot] = -1;
+	}
+}
+
+block_reader::~block_reader()
+{
+	if(ahead.joinable())
+		ahead.join();
+	for(int slot=0; slot<2; slot++)
+	{
+		free(block[slot].x);
+		free(x_space[slot]);
+	}
+}
+
+bool block_reader::read(int b, int slot)
+{
+	loaded[slot] = -1;
+	int l = bf->block_l[b];
+	long long nr_node = bf->nr_node[b];
+	feature_node *nodes = x_space[slot];
+	if(fseek64(bf->fp, bf->offset[b], SEEK_SET) != 0
+		|| fread(nodes, sizeof(feature_node), nr_node, bf->fp) != (size_t)nr_node
+		|| nodes[nr_node-1].index != -1)
+		return false;
+
+	// a row starts after the end of the previous one; indices out of
+	// 1, ..., n would be out of w
+	feature_node **x = block[slot].x;
+	int i = 0;
+	x[0] = nodes;
+	for(long long k=0; k<nr_node; k++)
+	{
+		int index = nodes[k].index;
+		if(index == -1)
+		{
+			if(++i < l)
+				x[i] = &nodes[k+1];
+		}
+		else if(index < 1 || index > bf->n)
+			return false;
+	}
+	if(i != l)
+		return false;
+
+	block[slot].l = l;
+	block[slot].n = bf->n;
+	block[slot].y = &bf->y[bf->start[b]];
+	block[slot].bias = -1;
+	loaded[slot] = b;
+	return true;
+}
+
+const problem *block_reader::get(int b)
+{
+	if(ahead.joinable())
+		ahead.join();
+
+	int slot = loaded[0] == b ? 0 : (loaded[1] == b ? 1 : -1);
+	if(slot < 0)
+	{
+		slot = loaded[0] < 0 ? 0 : 1;
+		if(!read(b, slot))
+			return NULL;
+	}
+
+	// with one or two blocks, they stay in memory
+	int next = (b+1) % bf->nr_block;
+	int other = 1-slot;
+	if(loaded[slot] != next && loaded[other] != next)
+	{
+		try
+		{
+			ahead = std::thread(&block_reader::read, this, next, other);
+		}
+		catch(...)
+		{
+			// the next block is read by get() without a thread
+			loaded[other] = -1;
+		}
+	}
+	return &block[slot];
+}
+
+const char *check_block_parameter(const parameter *param)
+{
+	problem prob;
+	prob.l = 0;
+	prob.n = 0;
+	prob.y = NULL;
+	prob.x = NULL;
+	prob.bias = -1;
+	const char *error_msg = check_parameter(&prob, param);
+	if(error_msg)
+		return error_msg;
+
+	if(param->solver_type != L2R_L2LOSS_SVC_DUAL
+		&& param->solver_type != L2R_L1LOSS_SVC_DUAL
+		&& param->solver_type != L2R_LR_DUAL
+		&& param->solver_type != L2R_L2LOSS_SVR_DUAL
+		&& param->solver_type != L2R_L1LOSS_SVR_DUAL)
+		return "Training on a block file supported only for dual solvers L2R_L2LOSS_SVC_DUAL, L2R_L1LOSS_SVC_DUAL, L2R_LR_DUAL, L2R_L2LOSS_SVR_DUAL, and L2R_L1LOSS_SVR_DUAL";
+
+	if(param->init_alpha != NULL)
+		return "Initial dual variables not supported for training on a block file";
+
+	if(param->neg_ratio > 0)
+		return "Sampling of negatives not supported for training on a block file";
+
+	return NULL;
+}
+
+model* train_blocks(const char *block_file_name, const parameter *param)
+{
+	int i, k;
+	block_file bf;
+	if(!open_block_file(block_file_name, &bf))
+		return NULL;
+
+	int l = bf.l;
+	int n = bf.n;
+	int solver_type = param->solver_type;
+	bool is_regression = (solver_type == L2R_L2LOSS_SVR_DUAL || solver_type == L2R_L1LOSS_SVR_DUAL);
+	// passes of the solver over a block in an outer iteration
+	int max_inner_iter = 10;
+	int max_iter = 100;
+
+	workspace ws;
+	ws.set_time_limit(param->max_time);
+	model *model_ = Malloc(model,1);
+	model_->param = *param;
+	model_->nr_feature = n;
+	model_->nr_class = 2;
+	model_->w = NULL;
+	model_->label = NULL;
+	model_->bias = -1;
+	model_->rho = 0;
+	model_->alpha = NULL;
+	model_->nr_alpha = 0;
+	model_->stopped_early = false;
+	model_->stat = NULL;
+
+	double start_time = workspace::now();
+	if(param->keep_stat)
+	{
+		model_->stat = Malloc(train_stat, 1);
+		memset(model_->stat, 0, sizeof(train_stat));
+	}
+	ws.stat = model_->stat;
+	ws.set_mem_phase(MEM_SETUP);
+
+	// the class of each row, from group_classes on the labels of all rows
+	int nr_class = 2;
+	int *label = NULL;
+	int *cls = NULL;
+	if(!is_regression)
+	{
+		problem all;
+		all.l = l;
+		all.n = n;
+		all.y = bf.y;
+		all.x = NULL;
+		all.bias = -1;
+		int *start = NULL;
+		int *count = NULL;
+		int *perm = Malloc(int,l);
+		group_classes(&all,&nr_class,&label,&start,&count,perm);
+		cls = Malloc(int,l);
+		for(i=0;i<nr_class;i++)
+			for(k=start[i];k<start[i]+count[i];k++)
+				cls[perm[k]] = i;
+		free(start);
+		free(count);
+		free(perm);
+	}
+	model_->nr_class = nr_class;
+	model_->label = label;
+
+	double *weighted_C = Malloc(double, nr_class);
+	for(i=0;i<nr_class;i++)
+		weighted_C[i] = param->C;
+	for(i=0;i<param->nr_weight && !is_regression;i++)
+	{
+		for(k=0;k<nr_class;k++)
+			if(param->weight_label[i] == label[k])
+				break;
+		if(k == nr_class)
+			fprintf(stderr,"WARNING: class label %d specified in weight is not found\n", param->weight_label[i]);
+		else
+			weighted_C[k] *= param->weight[i];
+	}
+
+	// one binary problem for two classes and regression, one per class otherwise;
+	// the dual variables of class k are in column col[k], by the order of labels
+	int nr_col = (is_regression || nr_class == 2) ? 1 : nr_class;
+	int *col = Malloc(int, nr_col);
+	if(nr_col > 1)
+		rank_labels(label, nr_col, col);
+	else
+		col[0] = 0;
+	double *w = Malloc(double, (size_t)n*nr_col);	// w of problem k at w[k*n]
+	double *alpha = Malloc(double, (size_t)l*nr_col);
+	double *w_rest = Malloc(double, n);
+	double *y_sub = Malloc(double, bf.max_l);
+	double *alpha_sub = Malloc(double, bf.max_l);
+	for(size_t j=0; j<(size_t)n*nr_col; j++)
+		w[j] = 0;
+	for(size_t j=0; j<(size_t)l*nr_col; j++)
+		alpha[j] = 0;
+	size_t mem = sizeof(double)*((size_t)l*(nr_col+1) + (size_t)n*(nr_col+1) + 2*(size_t)bf.max_l)
+		+ (is_regression ? 0 : sizeof(int)*(size_t)l)
+		+ 2*(sizeof(feature_node *)*(size_t)bf.max_l + sizeof(feature_node)*(size_t)bf.max_nr_node);
+	ws.mem_alloc(mem);
+	ws.set_mem_phase(MEM_SOLVE);
+
+	bool failed = false;
+	int iter = 0;
+	{
+		block_reader reader(&bf);
+		while(iter < max_iter && !failed && !ws.stopped())
+		{
+			iter++;
+			bool optimal = true;
+			for(int b=0; b<bf.nr_block && !ws.time_is_up(); b++)
+			{
+				const problem *block = reader.get(b);
+				if(block == NULL)
+				{
+					failed = true;
+					break;
+				}
+				int s = bf.start[b];
+				int block_l = block->l;
+				problem sub = *block;
+				for(k=0; k<nr_col; k++)
+				{
+					double Cp = 0, Cn = 0;
+					if(!is_regression)
+					{
+						int pos_class = nr_class == 2 ? 0 : k;
+						for(i=0; i<block_l; i++)
+							y_sub[i] = cls[s+i] == pos_class ? +1 : -1;
+						sub.y = y_sub;
+						Cp = weighted_C[pos_class];
+						Cn = nr_class == 2 ? weighted_C[1] : param->C;
+					}
+
+					// w of the rows out of the block
+					double *wk = &w[(size_t)k*n];
+					for(i=0; i<n; i++)
+						w_rest[i] = wk[i];
+					for(i=0; i<block_l; i++)
+					{
+						alpha_sub[i] = alpha[(size_t)(s+i)*nr_col+col[k]];
+						if(alpha_sub[i] != 0)
+							sparse_operator::axpy(is_regression ? -alpha_sub[i] : -sub.y[i]*alpha_sub[i], block->x[i], w_rest);
+					}
+
+					if(ws.stat)
+						ws.stat->nr_solve++;
+					int inner_iter;
+					if(solver_type == L2R_LR_DUAL)
+						inner_iter = solve_l2r_lr_dual(&sub, param, wk, alpha_sub, Cp, Cn, &ws, max_inner_iter, w_rest);
+					else if(is_regression)
+						inner_iter = solve_l2r_l1l2_svr(&sub, param, wk, alpha_sub, &ws, max_inner_iter, w_rest);
+					else
+						inner_iter = solve_l2r_l1l2_svc(&sub, param, wk, alpha_sub, Cp, Cn, &ws, max_inner_iter, w_rest);
+					if(inner_iter > 1)
+						optimal = false;
+
+					for(i=0; i<block_l; i++)
+						alpha[(size_t)(s+i)*nr_col+col[k]] = alpha_sub[i];
+				}
+			}
+			info("block iter %d\n", iter);
+			if(optimal && !ws.stopped())
+				break;
+		}
+	}
+	if(iter >= max_iter)
+		info("\nWARNING: reaching max number of block iterations\n");
+
+	ws.mem_free(mem);
+	free(w_rest);
+	free(y_sub);
+	free(alpha_sub);
+	free(weighted_C);
+	free(cls);
+	close_block_file(&bf);
+
+	if(failed)
+	{
+		free(w);
+		free(alpha);
+		free(col);
+		free_and_destroy_model(&model_);
+		return NULL;
+	}
+
+	if(nr_col == 1)
+		model_->w = w;
+	else
+	{
+		model_->w = Malloc(double, (size_t)n*nr_col);
+		for(k=0; k<nr_col; k++)
+			for(i=0; i<n; i++)
+				model_->w[(size_t)i*nr_col+k] = w[(size_t)k*n+i];
+		free(w);
+	}
+	free(col);
+	if(param->keep_alpha)
+	{
+		model_->alpha = alpha;
+		model_->nr_alpha = l*nr_col;
+	}
+	else
+		free(alpha);
+
+	model_->stopped_early = ws.stopped();
+	if(ws.stat)
+	{
+		ws.stat->time = workspace::now() - start_time;
+		ws.stat = NULL;
+	}
+	return model_;
+}
+
+// Bytes of the slots of the Newton method and of the function of solver_type
+static size_t newton_bytes(int solver_type, int l, int n)
+{
+	// NEWTON_S to NEWTON_Z, WS_WX and WS_TMP
+	size_t bytes = sizeof(double)*(7*(size_t)n + 2*(size_t)l);
+	if(solver_type == L2R_LR)
+		bytes += sizeof(double)*(size_t)l;	// WS_D
+	else
+		bytes += sizeof(int)*(size_t)l;	// WS_I
+	return bytes;
+}
+
+// Estimate of train_stat.peak_bytes of train() on a problem of l rows, n
+// columns (with the bias) and nnz nonzeros (with the bias) in nr_class
+// classes, from the same counts as the accounting of train_with_workspace.
+// A dual solver that may switch to the Newton method is counted with the
+// slots of both, so the estimate bounds such runs too. peak_bytes, if not
+// NULL, receives NR_MEM_PHASE values; the largest of them is returned.
+size_t estimate_train_memory(const parameter *param, int l, int n, size_t nnz, int nr_class, size_t *peak_bytes)
+{
+	int solver_type = param->solver_type;
+	size_t L = (size_t)l, N = (size_t)n;
+	size_t phase[NR_MEM_PHASE] = {0, 0, 0};
+	bool is_regression = (solver_type == L2R_L2LOSS_SVR ||
+				solver_type == L2R_L1LOSS_SVR_DUAL ||
+				solver_type == L2R_L2LOSS_SVR_DUAL);
+	bool has_alpha = param->init_alpha != NULL || param->keep_alpha;
+
+	// the solution, dual variables, and the labels and rows by class
+	size_t setup = 0;
+	if(is_regression)
+		setup = sizeof(double)*(N + (has_alpha ? L : 0));
+	else if(solver_type == ONECLASS_SVM)
+		setup = sizeof(double)*N;
+	else
+	{
+		setup = (sizeof(int)+sizeof(feature_node *)+sizeof(double))*L;
+		if(uses_row_layout(solver_type))
+			setup += sizeof(feature_node)*(nnz+L);	// at most, the rows copied in the order of the classes
+		if(solver_type == MCSVM_CS)
+			setup += sizeof(double)*N*nr_class;
+		else
+		{
+			int nr_col = nr_class == 2 ? 1 : nr_class;
+			if(has_alpha)
+				setup += sizeof(double)*L*(nr_col+1);	// and the WS_ALPHA slot
+			setup += sizeof(double)*N*(nr_class == 2 ? 1 : nr_class+1);
+			if(param->neg_ratio > 0 && nr_class > 2)	// at most, the slots of the sample of each class
+				setup += (sizeof(int)+sizeof(feature_node *)+2*sizeof(double))*L;
+		}
+	}
+	// the norms of the rows, and in the order of the classes the WS_XTX slot
+	if(uses_row_norms(solver_type))
+		setup += sizeof(double)*L*(is_regression || solver_type == ONECLASS_SVM ? 1 : 2);
+	phase[MEM_SETUP] = setup;
+
+	size_t solve = setup + solver_bytes(solver_type, l, n, nr_class, param->nr_thread);
+	if(solver_type == MCSVM_CS)
+		solve += (sizeof(int)+sizeof(double))*L*nr_class;	// at most, the dual variables of all classes listed
+	if(solver_type != MCSVM_CS && solver_type != ONECLASS_SVM)
+	{
+		// WS_C, and WS_ALPHA unless a dual solver was given the alpha of train()
+		solve += sizeof(double)*L;
+		if(!has_alpha)
+			solve += sizeof(double)*L;
+
+		switch(solver_type)
+		{
+			case L2R_LR:
+			case L2R_L2LOSS_SVC:
+			case L2R_L2LOSS_SVR:
+				solve += newton_bytes(solver_type, l, n);
+				break;
+			case L2R_L2LOSS_SVC_DUAL:
+				solve += newton_bytes(L2R_L2LOSS_SVC, l, n);
+				break;
+			case L2R_LR_DUAL:
+				solve += newton_bytes(L2R_LR, l, n);
+				break;
+			case L2R_L2LOSS_SVR_DUAL:
+				solve += newton_bytes(L2R_L2LOSS_SVR, l, n);
+				break;
+			case L1R_L2LOSS_SVC:
+			case L1R_LR:
+			{
+				size_t before = solve - solver_bytes(solver_type, l, n, nr_class, param->nr_thread);
+				size_t prob_col = transpose_bytes(l, n, nnz);
+				size_t rows = sizeof(feature_node *)*L;
+				phase[MEM_TRANSPOSE] = before + prob_col + max(transpose_count_bytes(n, param->nr_thread), rows);
+				solve += prob_col + rows;
+				break;
+			}
+			default:
+				break;
+		}
+	}
+	phase[MEM_SOLVE] = solve;
+
+	size_t peak = 0;
+	for(int i=0; i<NR_MEM_PHASE; i++)
+	{
+		peak = max(peak, phase[i]);
+		if(peak_bytes != NULL)
+			peak_bytes[i] = phase[i];
+	}
+	return peak;
+}
+
 double predict_values(const struct model *model_, const struct feature_node *x, double *dec_values)
 {
 	int idx;
@@ -3334,6 +5806,524 @@ double predict(const model *model_, const feature_node *x)
 	return label;
 }
 
+// The nonzero weights of each class of a classification model, as columns
+// in increasing order of features, with the scratch of predict_top_k. The
+// columns are built only if at most half of w is nonzero, so that they
+// never take more memory than w. A class_weights is used by one thread at
+// a time. Returns NULL for regression and one-class models.
+class_weights *make_class_weights(const model *model_)
+{
+	if(check_regression_model(model_) || check_oneclass_model(model_))
+		return NULL;
+
+	int n = model_->bias >= 0 ? model_->nr_feature+1 : model_->nr_feature;
+	int nr_w = (model_->nr_class == 2 && model_->param.solver_type != MCSVM_CS) ? 1 : model_->nr_class;
+	const double *w = model_->w;
+	size_t size = (size_t)n*nr_w;
+	size_t i;
+	int j;
+
+	class_weights *cw = Malloc(class_weights, 1);
+	cw->nr_w = nr_w;
+	cw->n = n;
+	cw->nnz = 0;
+	for(i=0; i<size; i++)
+		if(w[i] != 0)
+			cw->nnz++;
+	cw->start = NULL;
+	cw->node = NULL;
+	if(2*cw->nnz <= size)
+	{
+		cw->start = Malloc(size_t, nr_w+1);
+		cw->node = Malloc(feature_node, cw->nnz);
+		for(j=0; j<=nr_w; j++)
+			cw->start[j] = 0;
+		for(i=0; i<size; i++)
+			if(w[i] != 0)
+				cw->start[i%nr_w+1]++;
+		for(j=0; j<nr_w; j++)
+			cw->start[j+1] += cw->start[j];
+		// fill each column from its start, and move the starts back after
+		for(i=0; i<size; i++)
+			if(w[i] != 0)
+			{
+				feature_node *node = &cw->node[cw->start[i%nr_w]++];
+				node->index = (int)(i/nr_w)+1;
+				node->value = w[i];
+			}
+		for(j=nr_w; j>0; j--)
+			cw->start[j] = cw->start[j-1];
+		cw->start[0] = 0;
+	}
+	cw->dec = Malloc(double, nr_w);
+	cw->x = Malloc(double, n);
+	for(j=0; j<n; j++)
+		cw->x[j] = 0;
+	cw->heap = Malloc(int, nr_w);
+	return cw;
+}
+
+void free_class_weights(class_weights **cw_ptr)
+{
+	class_weights *cw = *cw_ptr;
+	if(cw != NULL)
+	{
+		free(cw->start);
+		free(cw->node);
+		free(cw->dec);
+		free(cw->x);
+		free(cw->heap);
+		free(cw);
+	}
+	*cw_ptr = NULL;
+}
+
+// whether class a of score dec[a] ranks after class b, ties going to the
+// class first in model->label as in predict()
+static inline bool ranks_after(const double *dec, int a, int b)
+{
+	return dec[a] < dec[b] || (dec[a] == dec[b] && a > b);
+}
+
+// restores the heap of classes heap[0..size) from position i down, with the
+// class ranking last at the root
+static void sift_down_classes(const double *dec, int *heap, int size, int i)
+{
+	while(2*i+1 < size)
+	{
+		int c = 2*i+1;
+		if(c+1 < size && ranks_after(dec, heap[c+1], heap[c]))
+			c++;
+		if(!ranks_after(dec, heap[c], heap[i]))
+			break;
+		swap(heap[i], heap[c]);
+		i = c;
+	}
+}
+
+// The min(k, nr_class) best classes of x by decision value, best first, in
+// label_ret and score_ret; the first label is that of predict(). The scores
+// come from the columns of cw when they hold fewer weights than the rows
+// of w the nonzeros of x select, and from w otherwise. The classes are
+// selected through a heap of k, so that k labels of a model of many classes
+// are found in O(nr_class log k) after the scores. Returns the number of
+// labels, or -1 for regression and one-class models.
+int predict_top_k(const model *model_, class_weights *cw, const feature_node *x, int k, double *label_ret, double *score_ret)
+{
+	if(cw == NULL || check_regression_model(model_) || check_oneclass_model(model_))
+		return -1;
+
+	int nr_class = model_->nr_class;
+	int nr_w = cw->nr_w;
+	int n = cw->n;
+	double *dec = cw->dec;
+	const feature_node *lx;
+	int i;
+	if(k > nr_class)
+		k = nr_class;
+	if(k <= 0)
+		return 0;
+
+	size_t nr_x = 0;
+	for(lx=x; lx->index!=-1; lx++)
+		if(lx->index <= n)
+			nr_x++;
+	if(cw->start != NULL && cw->nnz < nr_x*nr_w)
+	{
+		for(lx=x; lx->index!=-1; lx++)
+			if(lx->index <= n)
+				cw->x[lx->index-1] = lx->value;
+		for(i=0; i<nr_w; i++)
+		{
+			double s = 0;
+			for(size_t p=cw->start[i]; p<cw->start[i+1]; p++)
+				s += cw->node[p].value*cw->x[cw->node[p].index-1];
+			dec[i] = s;
+		}
+		for(lx=x; lx->index!=-1; lx++)
+			if(lx->index <= n)
+				cw->x[lx->index-1] = 0;
+	}
+	else
+		predict_values(model_, x, dec);
+
+	if(nr_w == 1)
+	{
+		// the decision value is of label[0], and its negative of label[1]
+		int first = dec[0] > 0 ? 0 : 1;
+		label_ret[0] = model_->label[first];
+		score_ret[0] = first == 0 ? dec[0] : -dec[0];
+		if(k > 1)
+		{
+			label_ret[1] = model_->label[1-first];
+			score_ret[1] = -score_ret[0];
+		}
+		return k;
+	}
+
+	// the heap keeps the k best classes so far, the worst of them at the root
+	int *heap = cw->heap;
+	int size = 0;
+	for(i=0; i<nr_class; i++)
+	{
+		if(size < k)
+		{
+			int c = size++;
+			heap[c] = i;
+			while(c > 0 && ranks_after(dec, heap[c], heap[(c-1)/2]))
+			{
+				swap(heap[c], heap[(c-1)/2]);
+				c = (c-1)/2;
+			}
+		}
+		else if(ranks_after(dec, heap[0], i))
+		{
+			heap[0] = i;
+			sift_down_classes(dec, heap, size, 0);
+		}
+	}
+	// taking the root out to the end leaves the best class first
+	while(size > 1)
+	{
+		swap(heap[0], heap[size-1]);
+		sift_down_classes(dec, heap, --size, 0);
+	}
+	for(i=0; i<k; i++)
+	{
+		label_ret[i] = model_->label[heap[i]];
+		score_ret[i] = dec[heap[i]];
+	}
+	return k;
+}
+
+// Quantized models keep each column of w as integers of 8 or 16 bits with
+// one scale per column, so each class is contiguous, and a sample is
+// rounded the same way with one scale for all its features. A decision
+// value is then an integer dot product times the two scales; the loops
+// below are plain so that the compiler vectorizes them.
+
+// the integer of largest magnitude of each width
+static inline int quantized_max(int bits)
+{
+	return bits == 8 ? 127 : 32767;
+}
+
+// v/scale rounded half away from zero, for |v/scale| <= quantized_max;
+// unlike lround() it is inlined into the loops and vectorized
+template <class Q> static inline Q round_quantized(double v, double inv_scale)
+{
+	double t = v*inv_scale;
+	return (Q)(t + (t >= 0 ? 0.5 : -0.5));
+}
+
+// rounds v[0..n) to q by scale = max|v|/quantized_max, and returns the scale
+template <class Q> static double quantize(const double *v, int n, int stride, int bits, Q *q)
+{
+	double max_abs = 0;
+	for(int j=0; j<n; j++)
+		max_abs = max(max_abs, fabs(v[(size_t)j*stride]));
+	double scale = max_abs/quantized_max(bits);
+	double inv_scale = scale > 0 ? 1/scale : 0;
+	for(int j=0; j<n; j++)
+		q[j] = round_quantized<Q>(v[(size_t)j*stride], inv_scale);
+	return scale;
+}
+
+// the products of 8-bit integers are summed in 32 bits over blocks short
+// enough not to overflow, and those of 16-bit integers in 64 bits
+static int64_t dot_quantized(const int8_t *a, const int8_t *b, int n)
+{
+	int64_t s = 0;
+	for(int j0=0; j0<n; j0+=65536)
+	{
+		int end = min(n, j0+65536);
+		int32_t t = 0;
+		for(int j=j0; j<end; j++)
+			t += (int32_t)a[j]*b[j];
+		s += t;
+	}
+	return s;
+}
+
+static int64_t dot_quantized(const int16_t *a, const int16_t *b, int n)
+{
+	int64_t s = 0;
+	for(int j=0; j<n; j++)
+		s += (int64_t)((int32_t)a[j]*b[j]);
+	return s;
+}
+
+// the label of the decision values as predict_values gives it
+static double quantized_label(const quantized_model *qm, double *dec_values)
+{
+	if(qm->solver_type == ONECLASS_SVM)
+	{
+		dec_values[0] -= qm->rho;
+		return (dec_values[0]>0)?1:-1;
+	}
+	if(qm->label == NULL)
+		return dec_values[0];
+	if(qm->nr_w == 1)
+		return (dec_values[0]>0)?qm->label[0]:qm->label[1];
+	int dec_max_idx = 0;
+	for(int i=1; i<qm->nr_class; i++)
+		if(dec_values[i] > dec_values[dec_max_idx])
+			dec_max_idx = i;
+	return qm->label[dec_max_idx];
+}
+
+template <class Q> static double predict_quantized_dense(quantized_model *qm, const double *x, double *dec_values)
+{
+	int n = qm->n;
+	int nr_feature = qm->nr_feature;
+	const Q *w = (const Q *)qm->w;
+	Q *xq = (Q *)qm->x;
+	double max_abs = qm->bias >= 0 ? qm->bias : 0;
+	for(int j=0; j<nr_feature; j++)
+		max_abs = max(max_abs, fabs(x[j]));
+	double x_scale = max_abs/quantized_max(qm->bits);
+	double inv_scale = x_scale > 0 ? 1/x_scale : 0;
+	for(int j=0; j<nr_feature; j++)
+		xq[j] = round_quantized<Q>(x[j], inv_scale);
+	if(qm->bias >= 0)
+		xq[n-1] = round_quantized<Q>(qm->bias, inv_scale);
+	for(int i=0; i<qm->nr_w; i++)
+		dec_values[i] = qm->scale[i]*x_scale*(double)dot_quantized(&w[(size_t)i*n], xq, n);
+	return quantized_label(qm, dec_values);
+}
+
+template <class Q> static double predict_quantized_values(quantized_model *qm, const feature_node *x, double *dec_values)
+{
+	int n = qm->n;
+	const Q *w = (const Q *)qm->w;
+	Q *xq = (Q *)qm->x;
+	const feature_node *lx;
+	double max_abs = 0;
+	for(lx=x; lx->index!=-1; lx++)
+		if(lx->index <= n)
+			max_abs = max(max_abs, fabs(lx->value));
+	double x_scale = max_abs/quantized_max(qm->bits);
+	double inv_scale = x_scale > 0 ? 1/x_scale : 0;
+	int nnz = 0;
+	for(lx=x; lx->index!=-1; lx++)
+		if(lx->index <= n)
+			xq[nnz++] = round_quantized<Q>(lx->value, inv_scale);
+	for(int i=0; i<qm->nr_w; i++)
+	{
+		const Q *wi = &w[(size_t)i*n];
+		int64_t s = 0;
+		int k = 0;
+		for(lx=x; lx->index!=-1; lx++)
+			if(lx->index <= n)
+				s += (int64_t)wi[lx->index-1]*xq[k++];
+		dec_values[i] = qm->scale[i]*x_scale*(double)s;
+	}
+	return quantized_label(qm, dec_values);
+}
+
+// A copy of model_ with each column of w rounded to integers of the given
+// bits, 8 or 16, which takes an eighth or a quarter of the memory of w.
+// Returns NULL for other bits.
+quantized_model *quantize_model(const model *model_, int bits)
+{
+	if(bits != 8 && bits != 16)
+		return NULL;
+
+	quantized_model *qm = Malloc(quantized_model, 1);
+	int n = model_->bias >= 0 ? model_->nr_feature+1 : model_->nr_feature;
+	int nr_w = (model_->nr_class == 2 && model_->param.solver_type != MCSVM_CS) ? 1 : model_->nr_class;
+	size_t width = bits/8;
+	qm->bits = bits;
+	qm->solver_type = model_->param.solver_type;
+	qm->nr_class = model_->nr_class;
+	qm->nr_feature = model_->nr_feature;
+	qm->nr_w = nr_w;
+	qm->n = n;
+	qm->label = NULL;
+	if(model_->label != NULL && !check_regression_model(model_) && !check_oneclass_model(model_))
+	{
+		qm->label = Malloc(int, model_->nr_class);
+		memcpy(qm->label, model_->label, sizeof(int)*model_->nr_class);
+	}
+	qm->bias = model_->bias;
+	qm->rho = model_->rho;
+	qm->w = malloc(width*(size_t)n*nr_w);
+	qm->scale = Malloc(double, nr_w);
+	qm->max_error = 0;
+	qm->x = malloc(width*(size_t)n);
+	for(int i=0; i<nr_w; i++)
+	{
+		if(bits == 8)
+			qm->scale[i] = quantize(&model_->w[i], n, nr_w, bits, &((int8_t *)qm->w)[(size_t)i*n]);
+		else
+			qm->scale[i] = quantize(&model_->w[i], n, nr_w, bits, &((int16_t *)qm->w)[(size_t)i*n]);
+	}
+	return qm;
+}
+
+// predict_values with a quantized model; x is sparse as for predict_values
+double predict_quantized_values(quantized_model *qm, const feature_node *x, double *dec_values)
+{
+	if(qm->bits == 8)
+		return predict_quantized_values<int8_t>(qm, x, dec_values);
+	return predict_quantized_values<int16_t>(qm, x, dec_values);
+}
+
+// predict_values with a quantized model on a dense sample of nr_feature
+// values; the bias is appended as in the sparse samples
+double predict_quantized_dense(quantized_model *qm, const double *x, double *dec_values)
+{
+	if(qm->bits == 8)
+		return predict_quantized_dense<int8_t>(qm, x, dec_values);
+	return predict_quantized_dense<int16_t>(qm, x, dec_values);
+}
+
+// The largest |decision value of qm - that of model_| over the samples x
+// and the columns, the calibration of the rounding on data like that to be
+// scored. It is also kept in qm->max_error.
+double quantized_max_error(quantized_model *qm, const model *model_, const feature_node * const *x, int l)
+{
+	double *dec = Malloc(double, qm->nr_w);
+	double *dec_q = Malloc(double, qm->nr_w);
+	double max_error = 0;
+	for(int i=0; i<l; i++)
+	{
+		predict_values(model_, x[i], dec);
+		predict_quantized_values(qm, x[i], dec_q);
+		for(int k=0; k<qm->nr_w; k++)
+			max_error = max(max_error, fabs(dec_q[k]-dec[k]));
+	}
+	free(dec);
+	free(dec_q);
+	qm->max_error = max_error;
+	return max_error;
+}
+
+void free_quantized_model(quantized_model **qm_ptr)
+{
+	quantized_model *qm = *qm_ptr;
+	if(qm != NULL)
+	{
+		free(qm->label);
+		free(qm->w);
+		free(qm->scale);
+		free(qm->x);
+		free(qm);
+	}
+	*qm_ptr = NULL;
+}
+
+// Stacks the weight vectors of models with one column of w each, such as
+// binary classifiers, regression and one-class models, into the rows of
+// one matrix of features by models. A row of input carries the bias term
+// as one node, at index nr_feature+1 with the value bias, so the models
+// with a bias must agree on both, and the others must have no feature at
+// that index. Returns NULL if a model has more columns or the biases do
+// not fit one row.
+model_stack *stack_models(const model * const *models, int nr_model)
+{
+	int n = 0;
+	int bias_index = 0;
+	double bias = -1;
+	for(int m=0; m<nr_model; m++)
+	{
+		const model *model_ = models[m];
+		if(model_->nr_class > 2 || model_->param.solver_type == MCSVM_CS)
+			return NULL;
+		if(model_->bias >= 0)
+		{
+			if(bias_index == 0)
+			{
+				bias_index = model_->nr_feature+1;
+				bias = model_->bias;
+			}
+			else if(model_->nr_feature+1 != bias_index || model_->bias != bias)
+				return NULL;
+		}
+		else
+			n = max(n, model_->nr_feature);
+	}
+	if(bias_index > 0)
+	{
+		if(n >= bias_index)
+			return NULL;
+		n = bias_index;
+	}
+
+	model_stack *ms = Malloc(model_stack, 1);
+	ms->nr_model = nr_model;
+	ms->n = n;
+	ms->w = Malloc(double, (size_t)n*nr_model);
+	ms->solver_type = Malloc(int, nr_model);
+	ms->label = Malloc(int, 2*nr_model);
+	ms->rho = Malloc(double, nr_model);
+	for(int m=0; m<nr_model; m++)
+	{
+		const model *model_ = models[m];
+		int n_m = model_->bias >= 0 ? model_->nr_feature+1 : model_->nr_feature;
+		for(int j=0; j<n; j++)
+			ms->w[(size_t)j*nr_model+m] = j < n_m ? model_->w[j] : 0;
+		ms->solver_type[m] = model_->param.solver_type;
+		ms->label[2*m] = ms->label[2*m+1] = 0;
+		if(model_->label != NULL && !check_regression_model(model_) && !check_oneclass_model(model_))
+		{
+			// a classifier of one class predicts its label for any value
+			ms->label[2*m] = model_->label[0];
+			ms->label[2*m+1] = model_->label[model_->nr_class == 2 ? 1 : 0];
+		}
+		ms->rho[m] = check_oneclass_model(model_) ? model_->rho : 0;
+	}
+	return ms;
+}
+
+// predict_values of every model of ms in one pass over x: each nonzero adds
+// its row of weights to dec_values. The labels are written if not NULL.
+void predict_stack(const model_stack *ms, const feature_node *x, double *dec_values, double *labels)
+{
+	int nr_model = ms->nr_model;
+	int idx;
+	for(int m=0; m<nr_model; m++)
+		dec_values[m] = 0;
+	for(const feature_node *lx=x; (idx=lx->index)!=-1; lx++)
+	{
+		if(idx <= ms->n)
+		{
+			const double *w = &ms->w[(size_t)(idx-1)*nr_model];
+			double v = lx->value;
+			for(int m=0; m<nr_model; m++)
+				dec_values[m] += w[m]*v;
+		}
+	}
+	for(int m=0; m<nr_model; m++)
+	{
+		int solver_type = ms->solver_type[m];
+		if(solver_type == ONECLASS_SVM)
+			dec_values[m] -= ms->rho[m];
+		if(labels == NULL)
+			continue;
+		if(solver_type == L2R_L2LOSS_SVR || solver_type == L2R_L1LOSS_SVR_DUAL || solver_type == L2R_L2LOSS_SVR_DUAL)
+			labels[m] = dec_values[m];
+		else if(solver_type == ONECLASS_SVM)
+			labels[m] = (dec_values[m]>0)?1:-1;
+		else
+			labels[m] = (dec_values[m]>0)?ms->label[2*m]:ms->label[2*m+1];
+	}
+}
+
+void free_model_stack(model_stack **ms_ptr)
+{
+	model_stack *ms = *ms_ptr;
+	if(ms != NULL)
+	{
+		free(ms->w);
+		free(ms->solver_type);
+		free(ms->label);
+		free(ms->rho);
+		free(ms);
+	}
+	*ms_ptr = NULL;
+}
+
 double predict_probability(const struct model *model_, const struct feature_node *x, double* prob_estimates)
 {
 	if(check_probability_model(model_))
@@ -3348,7 +6338,7 @@ double predict_probability(const struct model *model_, const struct feature_node
 
 		double label=predict_values(model_, x, prob_estimates);
 		for(i=0;i<nr_w;i++)
-			prob_estimates[i]=1/(1+exp(-prob_estimates[i]));
+			prob_estimates[i]=1/(1+vexp(-prob_estimates[i]));
 
 		if(nr_class==2) // for binary classification
 			prob_estimates[1]=1.-prob_estimates[0];
@@ -3482,8 +6472,18 @@ struct model *load_model(const char *model_file_name)
 	param.weight_label = NULL;
 	param.weight = NULL;
 	param.init_sol = NULL;
+	param.init_alpha = NULL;
+	param.keep_alpha = false;
+	param.nr_thread = 1;
+	param.max_time = 0;
+	param.keep_stat = false;
+	param.neg_ratio = 0;
 
 	model_->label = NULL;
+	model_->alpha = NULL;
+	model_->nr_alpha = 0;
+	model_->stopped_early = false;
+	model_->stat = NULL;
 
 	char *old_locale = setlocale(LC_ALL, NULL);
 	if (old_locale)
@@ -3667,6 +6667,14 @@ void free_model_content(struct model *model_ptr)
 	model_ptr->w = NULL;
 	free(model_ptr->label);
 	model_ptr->label = NULL;
+	free(model_ptr->alpha);
+	model_ptr->alpha = NULL;
+	if(model_ptr->stat != NULL)
+	{
+		free(model_ptr->stat->trace);
+		free(model_ptr->stat);
+		model_ptr->stat = NULL;
+	}
 }
 
 void free_and_destroy_model(struct model **model_ptr_ptr)
@@ -3688,6 +6696,8 @@ void destroy_param(parameter* param)
 	param->weight = NULL;
 	free(param->init_sol);
 	param->init_sol = NULL;
+	free(param->init_alpha);
+	param->init_alpha = NULL;
 }
 
 const char *check_parameter(const problem *prob, const parameter *param)
@@ -3698,6 +6708,9 @@ const char *check_parameter(const problem *prob, const parameter *param)
 	if(param->C <= 0)
 		return "C <= 0";
 
+	if(param->nr_thread <= 0)
+		return "nr_thread <= 0";
+
 	if(param->p < 0 && param->solver_type == L2R_L2LOSS_SVR)
 		return "p < 0";
 
@@ -3733,8 +6746,18 @@ const char *check_parameter(const problem *prob, const parameter *param)
 	if(param->init_sol != NULL
 		&& param->solver_type != L2R_LR
 		&& param->solver_type != L2R_L2LOSS_SVC
-		&& param->solver_type != L2R_L2LOSS_SVR)
-		return "Initial-solution specification supported only for solvers L2R_LR, L2R_L2LOSS_SVC, and L2R_L2LOSS_SVR";
+		&& param->solver_type != L2R_L2LOSS_SVR
+		&& param->solver_type != L1R_L2LOSS_SVC
+		&& param->solver_type != L1R_LR)
+		return "Initial-solution specification supported only for solvers L2R_LR, L2R_L2LOSS_SVC, L2R_L2LOSS_SVR, L1R_L2LOSS_SVC, and L1R_LR";
+
+	if((param->init_alpha != NULL || param->keep_alpha)
+		&& param->solver_type != L2R_L2LOSS_SVC_DUAL
+		&& param->solver_type != L2R_L1LOSS_SVC_DUAL
+		&& param->solver_type != L2R_LR_DUAL
+		&& param->solver_type != L2R_L2LOSS_SVR_DUAL
+		&& param->solver_type != L2R_L1LOSS_SVR_DUAL)
+		return "Dual variables can be given or kept only for dual solvers L2R_L2LOSS_SVC_DUAL, L2R_L1LOSS_SVC_DUAL, L2R_LR_DUAL, L2R_L2LOSS_SVR_DUAL, and L2R_L1LOSS_SVR_DUAL";
 
 	if(param->w_recalc == true
 		&& param->solver_type != L2R_L2LOSS_SVC_DUAL
@@ -1,4 +1,5 @@
 #include <stdbool.h>
+#include <stddef.h>
 #ifndef _LIBLINEAR_H
 #define _LIBLINEAR_H
 
@@ -41,6 +42,38 @@ struct parameter
 	double *init_sol;
 	int regularize_bias;
 	bool w_recalc;		/* for -s 1, 3; may be extended to -s 12, 13, 21 */
+	int nr_thread;		/* for -s 1, 3, 5, 6, 7, 12, 13, 21; used only when built with OpenMP */
+	double *init_alpha;	/* for -s 1, 3, 7, 12, 13; initial dual variables in the layout of model->alpha */
+	bool keep_alpha;	/* for -s 1, 3, 7, 12, 13; keep the dual variables in model->alpha */
+	double max_time;	/* time limit of training in seconds; no limit if <= 0 */
+	bool keep_stat;		/* keep the counters and the iteration trace of training in model->stat */
+	double neg_ratio;	/* for one-vs-rest of -s 0, 1, 2, 3, 5, 6, 7; negatives kept per class over its positives; all if <= 0 */
+};
+
+/* one iteration of a solver call */
+struct solver_iter
+{
+	int solve;              /* index of the solver call, e.g. the class of one-vs-rest */
+	int iter;               /* iteration in the solver call, from 1 */
+	double obj;             /* primal objective of the Newton method; NaN for the coordinate descent solvers */
+	double gnorm;           /* |g| of the Newton method, or the optimality violation the coordinate descent solvers stop on */
+	int active_size;        /* variables left by shrinking; all variables for the Newton method */
+};
+
+enum { MEM_SETUP, MEM_TRANSPOSE, MEM_SOLVE, NR_MEM_PHASE }; /* phases of training in train_stat.peak_bytes */
+
+struct train_stat
+{
+	int nr_solve;           /* solver calls */
+	int nr_iter;            /* iterations of all the calls, the length of trace */
+	int nr_cg_iter;         /* CG steps of the Newton method */
+	int nr_linesearch;      /* backtracking steps of the line searches */
+	double time;            /* seconds of training */
+	double time_Xv;         /* seconds in X*v of the Newton method */
+	double time_XTv;        /* seconds in X^T*v of the Newton method */
+	double time_Hv;         /* seconds in Hessian-vector products of the Newton method */
+	size_t peak_bytes[NR_MEM_PHASE]; /* largest bytes allocated by training in each phase; 0 for a phase not entered */
+	struct solver_iter *trace;
 };
 
 struct model
@@ -52,15 +85,77 @@ struct model
 	int *label;             /* label of each class */
 	double bias;
 	double rho;             /* one-class SVM only */
+	double *alpha;          /* dual variables if param.keep_alpha; alpha[i*nr_col+k] of sample i and k-th of nr_col binary problems, ordered by label value */
+	int nr_alpha;           /* length of alpha, l*nr_col; nr_col is nr_class if nr_class > 2 and 1 otherwise */
+	bool stopped_early;     /* true if training stopped at param.max_time before convergence */
+	struct train_stat *stat; /* if param.keep_stat */
+};
+
+/* the weights of a classification model by class for predict_top_k */
+struct class_weights
+{
+	int nr_w;               /* columns of w: nr_class, or 1 for two classes */
+	int n;                  /* features, with the bias */
+	size_t nnz;             /* nonzero weights */
+	size_t *start;          /* column i is node[start[i]] to node[start[i+1]-1]; NULL if w is too dense for columns to pay */
+	struct feature_node *node; /* nonzero weights of each column in increasing order of features */
+	double *dec;            /* scratch of nr_w decision values */
+	double *x;              /* scratch of n feature values, all 0 between calls */
+	int *heap;              /* scratch of nr_w classes for the selection of the best ones */
+};
+
+/* a model with the weights rounded to 8- or 16-bit integers for predict_quantized_values */
+struct quantized_model
+{
+	int bits;               /* 8 or 16 */
+	int solver_type;
+	int nr_class;
+	int nr_feature;
+	int nr_w;               /* columns of w: nr_class, or 1 for two classes, regression and one-class SVM */
+	int n;                  /* features, with the bias */
+	int *label;             /* NULL for regression and one-class SVM */
+	double bias;
+	double rho;
+	void *w;                /* int8_t or int16_t; column i is w[i*n] to w[i*n+n-1] */
+	double *scale;          /* a weight of column i is scale[i] times its integer */
+	double max_error;       /* largest deviation of a decision value found by quantized_max_error */
+	void *x;                /* scratch of n integers of the sample, like w */
+};
+
+/* models of one column of w stacked for predict_stack, each row holding a feature of all models */
+struct model_stack
+{
+	int nr_model;
+	int n;                  /* rows of w: the most features of a model, with its bias */
+	double *w;              /* weight of feature j+1 in model m is w[j*nr_model+m], 0 beyond the features of m */
+	int *solver_type;
+	int *label;             /* labels of model m for positive and other values: label[2*m] and label[2*m+1] */
+	double *rho;
 };
 
 struct model* train(const struct problem *prob, const struct parameter *param);
+void train_path(const struct problem *prob, const struct parameter *param, int nr_C, const double *C, struct model **models);
 void cross_validation(const struct problem *prob, const struct parameter *param, int nr_fold, double *target);
 void find_parameters(const struct problem *prob, const struct parameter *param, int nr_fold, double start_C, double start_p, double *best_C, double *best_p, double *best_score);
+size_t estimate_train_memory(const struct parameter *param, int l, int n, size_t nnz, int nr_class, size_t *peak_bytes);
+
+int save_block(const char *block_file_name, const struct problem *prob);
+struct model* train_blocks(const char *block_file_name, const struct parameter *param);
 
 double predict_values(const struct model *model_, const struct feature_node *x, double* dec_values);
 double predict(const struct model *model_, const struct feature_node *x);
 double predict_probability(const struct model *model_, const struct feature_node *x, double* prob_estimates);
+struct class_weights *make_class_weights(const struct model *model_);
+int predict_top_k(const struct model *model_, struct class_weights *cw, const struct feature_node *x, int k, double *label_ret, double *score_ret);
+void free_class_weights(struct class_weights **cw_ptr);
+struct quantized_model *quantize_model(const struct model *model_, int bits);
+double predict_quantized_values(struct quantized_model *qm, const struct feature_node *x, double *dec_values);
+double predict_quantized_dense(struct quantized_model *qm, const double *x, double *dec_values);
+double quantized_max_error(struct quantized_model *qm, const struct model *model_, const struct feature_node * const *x, int l);
+void free_quantized_model(struct quantized_model **qm_ptr);
+struct model_stack *stack_models(const struct model * const *models, int nr_model);
+void predict_stack(const struct model_stack *ms, const struct feature_node *x, double *dec_values, double *labels);
+void free_model_stack(struct model_stack **ms_ptr);
 
 int save_model(const char *model_file_name, const struct model *model_);
 struct model *load_model(const char *model_file_name);
@@ -77,6 +172,7 @@ void free_and_destroy_model(struct model **model_ptr_ptr);
 void destroy_param(struct parameter *param);
 
 const char *check_parameter(const struct problem *prob, const struct parameter *param);
+const char *check_block_parameter(const struct parameter *param);
 int check_probability_model(const struct model *model);
 int check_regression_model(const struct model *model);
 int check_oneclass_model(const struct model *model);
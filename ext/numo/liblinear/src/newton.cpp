@@ -1,8 +1,12 @@
 #include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
+#include <stdint.h>
+#include <chrono>
 #include "newton.h"
+#include "linear.h"
 
 #ifndef min
 template <class T> static inline T min(T x,T y) { return (x<y)?x:y; }
@@ -31,6 +35,101 @@ static void default_print(const char *buf)
 	fflush(stdout);
 }
 
+#define CACHE_LINE_SIZE 64
+
+workspace::workspace()
+{
+	for(int i=0;i<NR_SLOT;i++)
+	{
+		raw[i] = NULL;
+		ptr[i] = NULL;
+		capacity[i] = 0;
+	}
+	has_deadline = false;
+	deadline = 0;
+	is_stopped = false;
+	stat = NULL;
+	xTx = NULL;
+	trace_capacity = 0;
+	mem_bytes = 0;
+	mem_phase = 0;
+}
+
+workspace::~workspace()
+{
+	for(int i=0;i<NR_SLOT;i++)
+		delete[] raw[i];
+}
+
+void *workspace::reserve(int slot, size_t size)
+{
+	if(size > capacity[slot])
+	{
+		delete[] raw[slot];
+		raw[slot] = NULL;
+		mem_free(capacity[slot]);
+		capacity[slot] = 0;
+		raw[slot] = new char[size + CACHE_LINE_SIZE - 1];
+		ptr[slot] = (void *)(((uintptr_t)raw[slot] + CACHE_LINE_SIZE - 1) & ~(uintptr_t)(CACHE_LINE_SIZE - 1));
+		capacity[slot] = size;
+		mem_alloc(size);
+	}
+	return ptr[slot];
+}
+
+double workspace::now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void workspace::set_time_limit(double max_time)
+{
+	has_deadline = max_time > 0;
+	deadline = has_deadline ? now() + max_time : 0;
+	is_stopped = false;
+}
+
+bool workspace::time_is_up()
+{
+	if(has_deadline && now() >= deadline)
+		is_stopped = true;
+	return has_deadline && is_stopped;
+}
+
+void workspace::mem_alloc(size_t bytes)
+{
+	mem_bytes += bytes;
+	if(stat != NULL && mem_bytes > stat->peak_bytes[mem_phase])
+		stat->peak_bytes[mem_phase] = mem_bytes;
+}
+
+int workspace::set_mem_phase(int phase)
+{
+	int old_phase = mem_phase;
+	mem_phase = phase;
+	mem_alloc(0);
+	return old_phase;
+}
+
+void workspace::add_iter(int iter, double obj, double gnorm, int active_size)
+{
+	if(stat == NULL)
+		return;
+	if(stat->trace == NULL)
+		trace_capacity = 0;
+	if(stat->nr_iter == trace_capacity)
+	{
+		trace_capacity = trace_capacity > 0 ? 2*trace_capacity : 64;
+		stat->trace = (solver_iter *)realloc(stat->trace, sizeof(solver_iter)*trace_capacity);
+	}
+	solver_iter *it = &stat->trace[stat->nr_iter++];
+	it->solve = stat->nr_solve-1;
+	it->iter = iter;
+	it->obj = obj;
+	it->gnorm = gnorm;
+	it->active_size = active_size;
+}
+
 // On entry *f must be the function value of w
 // On exit w is updated and *f is the new function value
 double function::linesearch_and_update(double *w, double *s, double *f, double *g, double alpha)
@@ -39,7 +138,7 @@ double function::linesearch_and_update(double *w, double *s, double *f, double *
 	double eta = 0.01;
 	int n = get_nr_variable();
 	int max_num_linesearch = 20;
-	double *w_new = new double[n];
+	double *w_new = ws->get<double>(workspace::FUN_W_NEW, n);
 	double fold = *f;
 
 	for (int i=0;i<n;i++)
@@ -57,6 +156,8 @@ double function::linesearch_and_update(double *w, double *s, double *f, double *
 			alpha *= 0.5;
 	}
 
+	if (ws->stat)
+		ws->stat->nr_linesearch += num_linesearch;
 	if (num_linesearch >= max_num_linesearch)
 	{
 		*f = fold;
@@ -65,7 +166,6 @@ double function::linesearch_and_update(double *w, double *s, double *f, double *
 	else
 		memcpy(w, w_new, sizeof(double)*n);
 
-	delete [] w_new;
 	return alpha;
 }
 
@@ -100,21 +200,21 @@ void NEWTON::newton(double *w)
 	double f, fold, actred;
 	double init_step_size = 1;
 	int search = 1, iter = 1, inc = 1;
-	double *s = new double[n];
-	double *r = new double[n];
-	double *g = new double[n];
+	workspace *ws = fun_obj->get_workspace();
+	double *s = ws->get<double>(workspace::NEWTON_S, n);
+	double *r = ws->get<double>(workspace::NEWTON_R, n);
+	double *g = ws->get<double>(workspace::NEWTON_G, n);
 
 	const double alpha_pcg = 0.01;
-	double *M = new double[n];
+	double *M = ws->get<double>(workspace::NEWTON_M, n);
 
 	// calculate gradient norm at w=0 for stopping condition.
-	double *w0 = new double[n];
+	// s is not used until pcg, so it holds the zero vector here.
 	for (i=0; i<n; i++)
-		w0[i] = 0;
-	fun_obj->fun(w0);
-	fun_obj->grad(w0, g);
+		s[i] = 0;
+	fun_obj->fun(s);
+	fun_obj->grad(s, g);
 	double gnorm0 = dnrm2_(&n, g, &inc);
-	delete [] w0;
 
 	f = fun_obj->fun(w);
 	fun_obj->grad(w, g);
@@ -144,6 +244,9 @@ void NEWTON::newton(double *w)
 		gnorm = dnrm2_(&n, g, &inc);
 
 		info("iter %2d f %5.3e |g| %5.3e CG %3d step_size %4.2e \n", iter, f, gnorm, cg_iter, step_size);
+		if (ws->stat)
+			ws->stat->nr_cg_iter += cg_iter;
+		ws->add_iter(iter, f, gnorm, n);
 		
 		if (gnorm <= eps*gnorm0)
 			break;
@@ -158,17 +261,17 @@ void NEWTON::newton(double *w)
 			info("WARNING: actred too small\n");
 			break;
 		}
+		if (ws->time_is_up())
+		{
+			info("WARNING: reaching time limit\n");
+			break;
+		}
 
 		iter++;
 	}
 
 	if(iter >= max_iter)
 		info("\nWARNING: reaching max number of Newton iterations\n");
-
-	delete[] g;
-	delete[] r;
-	delete[] s;
-	delete[] M;
 }
 
 int NEWTON::pcg(double *g, double *M, double *s, double *r)
@@ -176,10 +279,11 @@ int NEWTON::pcg(double *g, double *M, double *s, double *r)
 	int i, inc = 1;
 	int n = fun_obj->get_nr_variable();
 	double one = 1;
-	double *d = new double[n];
-	double *Hd = new double[n];
+	workspace *ws = fun_obj->get_workspace();
+	double *d = ws->get<double>(workspace::NEWTON_D, n);
+	double *Hd = ws->get<double>(workspace::NEWTON_HD, n);
 	double zTr, znewTrnew, alpha, beta, cgtol, dHd;
-	double *z = new double[n];
+	double *z = ws->get<double>(workspace::NEWTON_Z, n);
 	double Q = 0, newQ, Qdiff;
 
 	for (i=0; i<n; i++)
@@ -200,7 +304,10 @@ int NEWTON::pcg(double *g, double *M, double *s, double *r)
 	{
 		cg_iter++;
 
+		double t = ws->stat ? workspace::now() : 0;
 		fun_obj->Hv(d, Hd);
+		if (ws->stat)
+			ws->stat->time_Hv += workspace::now() - t;
 		dHd = ddot_(&n, d, &inc, Hd, &inc);
 		// avoid 0/0 in getting alpha
 		if (dHd <= 1.0e-16)
@@ -225,6 +332,9 @@ int NEWTON::pcg(double *g, double *M, double *s, double *r)
 			break;
 		}
 		Q = newQ;
+		// s is a descent direction after any number of CG steps
+		if (ws->time_is_up())
+			break;
 
 		for (i=0; i<n; i++)
 			z[i] = r[i] / M[i];
@@ -238,10 +348,6 @@ int NEWTON::pcg(double *g, double *M, double *s, double *r)
 	if (cg_iter == max_cg_iter)
 		info("WARNING: reaching maximal number of CG steps\n");
 
-	delete[] d;
-	delete[] Hd;
-	delete[] z;
-
 	return cg_iter;
 }
 
@@ -1,9 +1,76 @@
 #ifndef _NEWTON_H
 #define _NEWTON_H
 
+#include <stddef.h>
+
+struct train_stat;
+
+// Scratch arrays shared by NEWTON and the function objects. A workspace is
+// owned by a training run and passed to every solver call of the run, so the
+// arrays are allocated once, grown only when a larger problem comes, and
+// reused by the later calls. The arrays are aligned to cache lines.
+class workspace
+{
+public:
+	// slots used in newton.cpp; users of the workspace number their own
+	// arrays from NR_NEWTON_SLOT
+	enum { NEWTON_S, NEWTON_R, NEWTON_G, NEWTON_M, NEWTON_D, NEWTON_HD, NEWTON_Z, FUN_W_NEW, NR_NEWTON_SLOT };
+	enum { NR_SLOT = 20 };
+
+	workspace();
+	~workspace();
+
+	// the contents of an array are kept only until the slot is requested with a larger size
+	template <class T> T *get(int slot, int n) { return (T *)reserve(slot, sizeof(T)*(size_t)n); }
+
+	// Time limit of the run in seconds from now; no limit if max_time <= 0.
+	// Solvers call time_is_up() once per iteration and stop when it returns
+	// true; stopped() tells whether any of them did since clear_stopped().
+	void set_time_limit(double max_time);
+	bool time_is_up();
+	bool stopped() const { return is_stopped; }
+	void clear_stopped() { is_stopped = false; }
+
+	// Telemetry of the run, collected only while stat is not NULL. The
+	// solvers call add_iter() once per iteration to extend stat->trace.
+	train_stat *stat;
+	void add_iter(int iter, double obj, double gnorm, int active_size);
+	static double now();	// seconds of the steady clock
+
+	// Squared norms of the rows of the problem given to the dual solvers,
+	// set by a caller that keeps them over several solver calls on the same
+	// rows; the solvers compute them while it is NULL.
+	const double *xTx;
+
+	// Memory accounting of the run: the bytes of the arrays alive, counted by
+	// reserve() for the slots and by mem_alloc() and mem_free() for the arrays
+	// the users allocate. While stat is not NULL, the largest count in each
+	// phase (MEM_* of linear.h) is kept in stat->peak_bytes.
+	void mem_alloc(size_t bytes);
+	void mem_free(size_t bytes) { mem_bytes -= bytes; }
+	int set_mem_phase(int phase);	// returns the previous phase
+
+private:
+	workspace(const workspace&);
+	workspace& operator=(const workspace&);
+	void *reserve(int slot, size_t size);
+
+	char *raw[NR_SLOT];
+	void *ptr[NR_SLOT];
+	size_t capacity[NR_SLOT];
+
+	bool has_deadline;
+	double deadline;	// in seconds of the steady clock
+	bool is_stopped;
+	int trace_capacity;
+	size_t mem_bytes;
+	int mem_phase;
+};
+
 class function
 {
 public:
+	function(workspace *ws): ws(ws) {}
 	virtual double fun(double *w) = 0 ;
 	virtual void grad(double *w, double *g) = 0 ;
 	virtual void Hv(double *s, double *Hs) = 0 ;
@@ -13,6 +80,11 @@ public:
 
 	// base implementation in newton.cpp
 	virtual double linesearch_and_update(double *w, double *s, double *f, double *g, double alpha);
+
+	workspace *get_workspace(void) { return ws; }
+
+protected:
+	workspace *ws;
 };
 
 class NEWTON
@@ -0,0 +1,139 @@
+#ifndef _VMATH_H
+#define _VMATH_H
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+// Branch-free exp and log for the loops of the logistic regression solvers.
+// They are inlined into the callers, so loops evaluating them over arrays
+// are vectorized by the compiler, unlike calls to exp() and log() of libm.
+// Special cases are handled with selects instead of branches; compilers
+// if-convert them only when -fno-trapping-math is given (see extconf.rb).
+//
+// Accuracy for finite arguments against long double references, as tested by
+// spec/native/vmath_test.cpp over the whole range, near 1 for vlog, near 0
+// and -1 for vlog1p, and over subnormal arguments and results:
+//   vexp(x):   <= 1 ulp; subnormal results are rounded twice, and
+//              results below/above the range of double are 0/inf.
+//   vlog(x):   <= 1 ulp.
+//   vlog1p(x): <= 1.5 ulp.
+// libm is correctly rounded or within 1 ulp for these functions as well.
+// Special values (NaN, inf, 0, negative arguments of log) follow libm.
+
+static inline double vmath_from_bits(uint64_t u)
+{
+	double d;
+	memcpy(&d, &u, sizeof(d));
+	return d;
+}
+
+static inline uint64_t vmath_to_bits(double d)
+{
+	uint64_t u;
+	memcpy(&u, &d, sizeof(u));
+	return u;
+}
+
+// 2^k for an integer-valued k in [-1022, 1023]
+static inline double vmath_pow2(double k)
+{
+	const double shifter = 6755399441055744.0; // 1.5*2^52, its low bits hold k after the addition
+	uint64_t bits = vmath_to_bits(k + shifter) - vmath_to_bits(shifter);
+	return vmath_from_bits((bits + 1023) << 52);
+}
+
+static inline double vexp(double x)
+{
+	const double log2e = 1.4426950408889634074;
+	const double ln2_hi = 6.93147180369123816490e-01;
+	const double ln2_lo = 1.90821492927058770002e-10;
+	const double shifter = 6755399441055744.0;
+
+	// the clamped range keeps 2^k representable as 2^k1 * 2^k2,
+	// and still gives inf and 0 outside of the range of double
+	double xc = x < -746.0 ? -746.0 : (x > 710.0 ? 710.0 : x);
+
+	// x = k*ln2 + r, |r| <= ln2/2
+	double k = (xc * log2e + shifter) - shifter;
+	double r = (xc - k * ln2_hi) - k * ln2_lo;
+
+	// Taylor series of e^r up to r^13, the truncation error is below 2^-60
+	double p = 1.0/6227020800.0;
+	p = p * r + 1.0/479001600.0;
+	p = p * r + 1.0/39916800.0;
+	p = p * r + 1.0/3628800.0;
+	p = p * r + 1.0/362880.0;
+	p = p * r + 1.0/40320.0;
+	p = p * r + 1.0/5040.0;
+	p = p * r + 1.0/720.0;
+	p = p * r + 1.0/120.0;
+	p = p * r + 1.0/24.0;
+	p = p * r + 1.0/6.0;
+	p = p * r + 0.5;
+	p = p * r * r + r + 1.0;
+
+	double k1 = (k * 0.5 + shifter) - shifter;
+	double k2 = k - k1;
+	// NaN propagates through k and p
+	return p * vmath_pow2(k1) * vmath_pow2(k2);
+}
+
+static inline double vlog(double x)
+{
+	const double ln2_hi = 6.93147180369123816490e-01;
+	const double ln2_lo = 1.90821492927058770002e-10;
+	const double sqrt2 = 1.41421356237309504880;
+
+	// x = m * 2^e, sqrt(2)/2 <= m < sqrt(2); subnormal x is scaled by 2^54 first
+	bool subnormal = x < 2.2250738585072014e-308;
+	uint64_t bits = vmath_to_bits(x * (subnormal ? 18014398509481984.0 : 1.0));
+	double e = vmath_from_bits(0x4330000000000000ULL | (bits >> 52)) - 4503599627370496.0 - 1023.0;
+	double m = vmath_from_bits((bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL);
+	bool large = m > sqrt2;
+	m *= large ? 0.5 : 1.0;
+	e += (large ? 1.0 : 0.0) - (subnormal ? 54.0 : 0.0);
+
+	// log(m) = 2 atanh(s), s = (m-1)/(m+1), |s| <= 0.1716
+	double f = m - 1.0;
+	double s = f / (2.0 + f);
+	double z = s * s;
+	double q = 1.0/21;
+	q = q * z + 1.0/19;
+	q = q * z + 1.0/17;
+	q = q * z + 1.0/15;
+	q = q * z + 1.0/13;
+	q = q * z + 1.0/11;
+	q = q * z + 1.0/9;
+	q = q * z + 1.0/7;
+	q = q * z + 1.0/5;
+	q = q * z + 1.0/3;
+	// log(m) = f - f^2/2 + s*(f^2/2 + R), R = 2*z*q, as in fdlibm
+	double hfsq = 0.5 * f * f;
+	double c = s * (hfsq + 2.0 * z * q) - hfsq + e * ln2_lo;
+	// e*ln2_hi is exact, and its sum with f is kept exactly as a + b so that
+	// only the small term c and the last addition are rounded
+	double a_hi = e * ln2_hi;
+	double a = a_hi + f;
+	double t = a - a_hi;
+	double b = (a_hi - (a - t)) + (f - t);
+	double y = a + (b + c);
+
+	// y is finite for any x, and the special values are added to it
+	return y + (x == 0 ? -HUGE_VAL : 0.0) + (x == HUGE_VAL ? HUGE_VAL : 0.0)
+		+ (x >= 0 ? 0.0 : NAN);
+}
+
+static inline double vlog1p(double x)
+{
+	// log(1+x) = log(u) + (x-(u-1))/u, u = fl(1+x);
+	// for tiny x, u = 1 and the correction term gives x itself
+	double u = 1.0 + x;
+	double c = (x - (u - 1.0)) / (u + (u == 0 ? 1.0 : 0.0));
+	double y = vlog(u) + c;
+	y = x == HUGE_VAL ? x : y;
+	// log1p(x) has the sign of x, including -0
+	return copysign(y, x);
+}
+
+#endif
@@ -0,0 +1,105 @@
+// Tests the threshold of the subproblem of the Crammer-Singer solver found by
+// selection against the sort-based computation of LIBLINEAR 2.49, which it
+// replaced. linear.cpp is included as a whole, so that the static function
+// is called directly. The cases cover distinct values, ties of small
+// integers where the sums are exact and the thresholds must be equal, all
+// values equal, and A_i*C_yi of 0, where no D_m is above the threshold.
+//
+// usage: mcsvm_test [-n cases]
+
+#include "linear.cpp"
+
+static unsigned long long rng_state = 1;
+
+static unsigned long long next_bits()
+{
+	// xorshift64*
+	rng_state ^= rng_state >> 12;
+	rng_state ^= rng_state << 25;
+	rng_state ^= rng_state >> 27;
+	return rng_state * 2685821657736338717ULL;
+}
+
+static double next_uniform()
+{
+	return (double)(next_bits() >> 11) / 9007199254740992.0;
+}
+
+static int compare_double_desc(const void *a, const void *b)
+{
+	if(*(const double *)a > *(const double *)b)
+		return -1;
+	if(*(const double *)a < *(const double *)b)
+		return 1;
+	return 0;
+}
+
+// Solver_MCSVM_CS::solve_sub_problem of LIBLINEAR 2.49
+static double sorted_threshold(double *D, int active_i, double AC_yi)
+{
+	qsort(D, active_i, sizeof(double), compare_double_desc);
+	double beta = D[0] - AC_yi;
+	int r;
+	for(r=1;r<active_i && beta<r*D[r];r++)
+		beta += D[r];
+	return beta/r;
+}
+
+enum { DISTINCT, TIES, EQUAL, NR_KIND };
+
+int main(int argc, char **argv)
+{
+	int nr_case = 200000;
+	if(argc == 3 && argv[1][0] == '-' && argv[1][1] == 'n')
+		nr_case = atoi(argv[2]);
+
+	const char *kind_name[NR_KIND] = {"distinct", "ties", "equal"};
+	const int max_active = 64;
+	double B[max_active], D[max_active], D_sorted[max_active];
+	int nr_failure = 0;
+	double max_error[NR_KIND][2] = {{0}};
+
+	for(int t=0; t<nr_case; t++)
+	{
+		int kind = t % NR_KIND;
+		int active_i = 1 + (int)(next_bits() % max_active);
+		bool zero_AC = (t/NR_KIND) % 4 == 0;
+		for(int m=0; m<active_i; m++)
+		{
+			if(kind == DISTINCT)
+				B[m] = 4*next_uniform() - 2;
+			else if(kind == TIES)
+				B[m] = (double)(int)(next_bits() % 7) - 3;
+			else
+				B[m] = m == 0 ? (double)(int)(next_bits() % 7) - 3 : B[0];
+		}
+		// A_i*C_yi is added to D_yi unless y_i is shrunk
+		int yi = (int)(next_bits() % (active_i+1));
+		double AC_yi = zero_AC ? 0 : (kind == DISTINCT ? 3*next_uniform() : (double)(1 + next_bits() % 5));
+		for(int m=0; m<active_i; m++)
+			D[m] = D_sorted[m] = B[m] + (m == yi ? AC_yi : 0);
+
+		double beta = sub_problem_threshold(D, active_i, AC_yi);
+		double expected = sorted_threshold(D_sorted, active_i, AC_yi);
+		double err = fabs(beta - expected);
+		max_error[kind][zero_AC] = max(max_error[kind][zero_AC], err);
+		// the sums of integers are exact, so only the distinct values may
+		// differ in the order of their additions
+		bool ok = kind == DISTINCT ? err <= 1e-13*(1 + fabs(expected)) : beta == expected;
+		if(!ok && nr_failure++ < 10)
+			printf("FAIL %-8s active_i %d A_i*C_yi %g: beta %.17g, sorted %.17g\n", kind_name[kind], active_i,
+				AC_yi, beta, expected);
+	}
+
+	for(int kind=0; kind<NR_KIND; kind++)
+		for(int zero_AC=0; zero_AC<2; zero_AC++)
+			printf("%-8s A_i*C_yi %-4s max |beta - sorted| %g\n", kind_name[kind], zero_AC ? "0" : "> 0",
+				max_error[kind][zero_AC]);
+	if(nr_failure > 0)
+	{
+		printf("%d failures\n", nr_failure);
+		return 1;
+	}
+	printf("all passed\n");
+	return 0;
+}
@@ -0,0 +1,189 @@
+// Tests the accuracy bounds documented in vmath.h against the long double
+// functions of libm, which are accurate well beyond double where long double
+// is wider than double. Each function is swept over random arguments of its
+// whole range, over the ranges where the result loses bits or cancels (near
+// 1 for vlog, near 0 and -1 for vlog1p, subnormal arguments and results),
+// and over the special values. The functions are evaluated in loops over
+// arrays as in the solvers, so the vectorized code is what is tested.
+//
+// usage: vmath_test [-n arguments per sweep]
+
+#include "vmath.h"
+
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static unsigned long long rng_state = 1;
+
+static unsigned long long next_bits()
+{
+	// xorshift64*
+	rng_state ^= rng_state >> 12;
+	rng_state ^= rng_state << 25;
+	rng_state ^= rng_state >> 27;
+	return rng_state * 2685821657736338717ULL;
+}
+
+static double next_uniform(double a, double b)
+{
+	return a + (b-a)*((double)(next_bits() >> 11) / 9007199254740992.0);
+}
+
+// the error of y in units of the last place of the double nearest to ref;
+// below DBL_MIN the unit is that of the subnormals
+static double ulp_error(double y, long double ref)
+{
+	double r = (double)ref;
+	if(isinf(r) || isinf(y))
+		return y == r ? 0 : HUGE_VAL;
+	int e;
+	frexp(r, &e);
+	double ulp = fabs(r) < DBL_MIN ? ldexp(1.0, -1074) : ldexp(1.0, e-53);
+	return (double)(fabsl((long double)y - ref) / ulp);
+}
+
+struct sweep_result
+{
+	double max_error;
+	double worst_x;
+};
+
+typedef double (*vmath_fn)(double);
+
+#define VMATH_LOOP(name, fn) \
+	static void name(const double *x, double *y, int n) \
+	{ \
+		for(int i=0; i<n; i++) \
+			y[i] = fn(x[i]); \
+	}
+
+VMATH_LOOP(loop_vexp, vexp)
+VMATH_LOOP(loop_vlog, vlog)
+VMATH_LOOP(loop_vlog1p, vlog1p)
+
+typedef void (*loop_fn)(const double *, double *, int);
+typedef long double (*ref_fn)(long double);
+
+static int nr_failure = 0;
+
+static void check_sweep(const char *name, const char *range, loop_fn loop, ref_fn ref,
+	const double *x, double *y, int n, double bound)
+{
+	loop(x, y, n);
+	sweep_result res = {0, 0};
+	for(int i=0; i<n; i++)
+	{
+		double err = ulp_error(y[i], ref(x[i]));
+		if(err > res.max_error)
+		{
+			res.max_error = err;
+			res.worst_x = x[i];
+		}
+	}
+	bool ok = res.max_error <= bound;
+	printf("%-4s %-7s %-30s max %.4f ulp (bound %.1f) at %.17g\n", ok ? "ok" : "FAIL", name, range,
+		res.max_error, bound, res.worst_x);
+	if(!ok)
+		nr_failure++;
+}
+
+// NaN, inf and zero results must be those of libm, with the sign of zero;
+// others are within the bound of the long double reference
+static void check_special(const char *name, vmath_fn fn, double (*libm_fn)(double), ref_fn ref,
+	double x, double bound)
+{
+	double y = fn(x);
+	double expected = libm_fn(x);
+	bool ok;
+	if(isnan(expected))
+		ok = isnan(y);
+	else if(isinf(expected) || expected == 0)
+		ok = y == expected && signbit(y) == signbit(expected);
+	else
+		ok = ulp_error(y, ref(x)) <= bound;
+	if(!ok)
+	{
+		printf("FAIL %-7s special %-21.17g got %.17g, libm %.17g\n", name, x, y, expected);
+		nr_failure++;
+	}
+}
+
+static double positive_bits()
+{
+	double x;
+	unsigned long long b = next_bits() >> 1;
+	memcpy(&x, &b, sizeof(x));
+	return x;
+}
+
+int main(int argc, char **argv)
+{
+	int n = 2000000;
+	if(argc == 3 && argv[1][0] == '-' && argv[1][1] == 'n')
+		n = atoi(argv[2]);
+	if(LDBL_MANT_DIG <= DBL_MANT_DIG + 10)
+	{
+		printf("skipped: long double has %d bits of mantissa, too few for references\n", LDBL_MANT_DIG);
+		return 0;
+	}
+
+	// the bounds documented in vmath.h
+	const double vexp_bound = 1.0, vlog_bound = 1.0, vlog1p_bound = 1.5;
+
+	double *x = new double[n];
+	double *y = new double[n];
+	int i;
+
+	for(i=0; i<n; i++) x[i] = next_uniform(-708.3, 709.7);
+	check_sweep("vexp", "[-708.3, 709.7]", loop_vexp, expl, x, y, n, vexp_bound);
+	for(i=0; i<n; i++) x[i] = next_uniform(-1, 1)*ldexp(1.0, -(int)(next_bits() % 60));
+	check_sweep("vexp", "|x| in [2^-60, 1]", loop_vexp, expl, x, y, n, vexp_bound);
+	for(i=0; i<n; i++) x[i] = next_uniform(-745.1, -708.4);
+	check_sweep("vexp", "subnormal results", loop_vexp, expl, x, y, n, vexp_bound);
+
+	for(i=0; i<n; i++)
+	{
+		do x[i] = positive_bits(); while(!isfinite(x[i]) || x[i] == 0);
+	}
+	check_sweep("vlog", "(0, DBL_MAX] by bits", loop_vlog, logl, x, y, n, vlog_bound);
+	for(i=0; i<n; i++) x[i] = next_uniform(0.5, 2);
+	check_sweep("vlog", "[0.5, 2]", loop_vlog, logl, x, y, n, vlog_bound);
+	for(i=0; i<n; i++) x[i] = 1 + next_uniform(-1, 1)*ldexp(1.0, -(int)(next_bits() % 53));
+	check_sweep("vlog", "1 + [-2^-k, 2^-k]", loop_vlog, logl, x, y, n, vlog_bound);
+	for(i=0; i<n; i++) x[i] = next_uniform(0, DBL_MIN);
+	check_sweep("vlog", "subnormal", loop_vlog, logl, x, y, n, vlog_bound);
+
+	for(i=0; i<n; i++)
+	{
+		do x[i] = positive_bits(); while(!isfinite(x[i]));
+		if(next_bits() & 1)
+			x[i] = -ldexp(next_uniform(0, 1), -(int)(next_bits() % 1074));
+	}
+	check_sweep("vlog1p", "(-1, DBL_MAX] by bits", loop_vlog1p, log1pl, x, y, n, vlog1p_bound);
+	for(i=0; i<n; i++) x[i] = next_uniform(-0.5, 1);
+	check_sweep("vlog1p", "[-0.5, 1]", loop_vlog1p, log1pl, x, y, n, vlog1p_bound);
+	for(i=0; i<n; i++) x[i] = next_uniform(-1, 1)*ldexp(1.0, -(int)(next_bits() % 60));
+	check_sweep("vlog1p", "|x| in [2^-60, 1]", loop_vlog1p, log1pl, x, y, n, vlog1p_bound);
+	for(i=0; i<n; i++) x[i] = -1 + ldexp(next_uniform(0, 1), -(int)(next_bits() % 53));
+	check_sweep("vlog1p", "-1 + [0, 2^-k]", loop_vlog1p, log1pl, x, y, n, vlog1p_bound);
+
+	const double specials[] = {0.0, -0.0, 1.0, -1.0, 2.0, 0.5, -0.5, DBL_MIN, -DBL_MIN, 4.9406564584124654e-324,
+		DBL_MAX, -DBL_MAX, 709.78, 709.79, -745.13, -745.14, 1e-300, -1e-300, HUGE_VAL, -HUGE_VAL, NAN};
+	for(double s : specials)
+	{
+		check_special("vexp", vexp, exp, expl, s, vexp_bound);
+		check_special("vlog", vlog, log, logl, s, vlog_bound);
+		check_special("vlog1p", vlog1p, log1p, log1pl, s, vlog1p_bound);
+	}
+
+	delete [] x;
+	delete [] y;
+	if(nr_failure > 0)
+	{
+		printf("%d failures\n", nr_failure);
+		return 1;
+	}
+	printf("all passed\n");
+	return 0;
+}
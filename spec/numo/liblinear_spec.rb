@@ -54,6 +54,107 @@ RSpec.describe Numo::Liblinear do
       expect(accuracy(y_test, pr)).to be_within(0.05).of(0.95)
     end
 
+    it 'trains Crammer-Singer SVC to the solution of the sort-based subproblem', :aggregate_failures do
+      # w given by sorting the values of each subproblem, as LIBLINEAR 2.49 does
+      param = { solver_type: Numo::Liblinear::SolverType::MCSVM_CS, C: 1, random_seed: 1 }
+      w = Numo::DFloat[-0.1017037971, -0.0181417377, 0.1198455348, 1.0817726720, -1.3723776709, 0.2906049989,
+                       -1.0149830191, 0.2913944608, 0.7235885584, -1.0999926982, -0.8555462750, 1.9555389732]
+      expect((described_class.train(x, y, param)[:w] - w).abs.max).to be < 1e-8
+      # ties of the rounded samples, each given twice, and A_i*C_yi of 0 for the samples of the first label
+      x_tie = Numo::NArray.vstack([(x * 2).round, (x * 2).round])
+      y_tie = Numo::NArray.hstack([y, y])
+      param_tie = param.merge(eps: 1e-5, nr_weight: 1, weight_label: Numo::Int32[1], weight: Numo::DFloat[0])
+      w_tie = Numo::DFloat[0.0000002078, -0.0000004157, 0.0000002078, 0.3333345930, -0.6666672912, 0.3333326983,
+                           -0.0000018276, 0.0000009910, 0.0000008366, 0.0, -1.0000000720, 1.0000000720]
+      expect((described_class.train(x_tie, y_tie, param_tie)[:w] - w_tie).abs.max).to be < 1e-5
+    end
+
+    it 'trains Crammer-Singer SVC of many classes to the solution with all dual variables kept', :aggregate_failures do
+      # nine classes by the first feature, so that most dual variables of a sample are 0
+      y_many = ((x[true, 0] + 1) * 4).floor
+      param = { solver_type: Numo::Liblinear::SolverType::MCSVM_CS, C: 1, random_seed: 1 }
+      model = described_class.train(x, y_many, param)
+      # w given by keeping the dual variables of all classes for each sample
+      w = Numo::DFloat[-0.4912998619, -0.4763822944, -0.4765253105, -0.5138651897, 0.4252407380, 0.0831928583,
+                       0.5704930140, 0.4554021590, 0.4237438872, -0.0482497772, -0.0450236601, -0.0438657518,
+                       -0.0089693268, 0.1283000272, -0.3232262313, 0.0824098297, 0.1214015889, 0.1372233016,
+                       -0.0570507269, -0.0211646558, -0.0198624604, 0.2895544708, 0.0992903353, -0.2552375542,
+                       -0.1302610090, 0.0260971698, 0.0686344302, 0.0591662592, 0.0177559118, 0.0116638608,
+                       -0.1452283588, -0.1517423235, 0.4493064051, -0.0108210873, -0.1027946689, -0.1273059985]
+      expect(model[:nr_class]).to eq(9)
+      expect((model[:w] - w).abs.max).to be < 1e-8
+    end
+
+    it 'predicts the best labels with their decision values', :aggregate_failures do
+      labels, scores = described_class.predict_top_k(x_test, svc_param, svc_model, 2)
+      df = described_class.decision_function(x_test, svc_param, svc_model)
+      pr = described_class.predict(x_test, svc_param, svc_model)
+      expect(labels.shape).to eq([n_samples, 2])
+      expect(labels[true, 0]).to eq(pr)
+      expect(scores[true, 0]).to eq(df.max(axis: 1))
+      expect((scores[true, 0] >= scores[true, 1]).all?).to be(true)
+      expect { described_class.predict_top_k(x_test, svc_param, svc_model, 0) }.to raise_error(ArgumentError)
+    end
+
+    it 'predicts the best labels of an L1-regularized model from the columns of its weights', :aggregate_failures do
+      y_many = ((x[true, 0] + 1) * 4).floor
+      param = { solver_type: Numo::Liblinear::SolverType::L1R_L2LOSS_SVC, C: 0.1, random_seed: 1 }
+      model = described_class.train(x, y_many, param)
+      labels, scores = described_class.predict_top_k(x_test, param, model, model[:nr_class])
+      df = described_class.decision_function(x_test, param, model)
+      col = model[:label].to_a.each_with_index.to_h
+      expected = Numo::DFloat.cast(Array.new(n_samples) { |i| labels[i, true].to_a.map { |l| df[i, col[l.to_i]] } })
+      # at most half of the weights are nonzero, so the scores are computed from the columns
+      expect(model[:w].ne(0).count).to be <= model[:w].size / 2
+      expect(labels[true, 0]).to eq(described_class.predict(x_test, param, model))
+      expect(scores).to eq(expected)
+      expect((scores[true, 0...-1] >= scores[true, 1..-1]).all?).to be(true)
+    end
+
+    it 'scores samples with several binary models in one pass', :aggregate_failures do
+      params = classes.to_a.map { |c| svc_param.merge(C: 0.5 * c) }
+      models = classes.to_a.zip(params).map { |c, param| described_class.train(x, Numo::DFloat.cast(y.eq(c)) * 2 - 1, param) }
+      df = described_class.decision_function_ensemble(x_test, params, models)
+      pr = described_class.predict_ensemble(x_test, params, models)
+      expect(df.shape).to eq([n_samples, n_classes])
+      models.each_with_index do |model, m|
+        expect((df[true, m] - described_class.decision_function(x_test, params[m], model)).abs.max).to be < 1e-12
+        expect(pr[true, m]).to eq(described_class.predict(x_test, params[m], model))
+      end
+      expect { described_class.predict_ensemble(x_test, [svc_param], [svc_model]) }.to raise_error(ArgumentError)
+    end
+
+    it 'scores models with a bias term only when the bias fits one sample', :aggregate_failures do
+      y_bin = (Numo::DFloat.cast(y.eq(1)) * 2) - 1
+      model = described_class.train(x, y_bin, svc_param)
+      biased = model.merge(bias: 1.0, w: model[:w].concatenate(Numo::DFloat[0.5]))
+      wide = described_class.train(Numo::NArray.hstack([x, x[true, 0...1]]), y_bin, svc_param)
+      # the bias term is the last column of the samples
+      x_bias = Numo::NArray.hstack([x_test, Numo::DFloat.ones(n_samples, 1)])
+      df = described_class.decision_function_ensemble(x_bias, [svc_param] * 2, [biased, model])
+      expect((df[true, 0] - described_class.decision_function(x_bias, svc_param, biased)).abs.max).to be < 1e-12
+      expect((df[true, 1] - described_class.decision_function(x_test, svc_param, model)).abs.max).to be < 1e-12
+      expect { described_class.decision_function_ensemble(x_bias, [svc_param] * 2, [biased, biased.merge(bias: 2.0)]) }
+        .to raise_error(ArgumentError)
+      expect { described_class.decision_function_ensemble(x_bias, [svc_param] * 2, [biased, wide]) }
+        .to raise_error(ArgumentError)
+    end
+
+    it 'predicts labels with the quantized model of C-SVC', :aggregate_failures do
+      df = described_class.decision_function(x_test, svc_param, svc_model)
+      { 8 => Numo::Int8, 16 => Numo::Int16 }.each do |bits, w_class|
+        qmodel = described_class.quantize(x_test, svc_param, svc_model, bits)
+        qdf = described_class.decision_function_quantized(x_test, qmodel)
+        pr = described_class.predict_quantized(x_test, qmodel)
+        expect(qmodel[:w].class).to eq(w_class)
+        expect(qmodel[:w].shape).to eq([n_classes, x_test.shape[1]])
+        expect((qdf - df).abs.max).to be <= qmodel[:max_error] + 1e-12
+        expect(qmodel[:max_error]).to be < 0.05 * df.abs.max
+        expect(accuracy(y_test, pr)).to be_within(0.05).of(0.95)
+      end
+      expect { described_class.quantize(x_test, svc_param, svc_model, 4) }.to raise_error(ArgumentError)
+    end
+
     it 'predicts probabilities with Logistic Regression', :aggregate_failures do
       pb = described_class.predict_proba(x_test, logit_param, logit_model)
       pr = Numo::Int32[*Array.new(n_samples) { |n| classes[pb[n, true].max_index] }] # rubocop:disable Lint/RedundantSplatExpansion
@@ -63,6 +164,190 @@ RSpec.describe Numo::Liblinear do
       expect(accuracy(y_test, pr)).to be_within(0.05).of(0.95)
     end
 
+    it 'predicts probabilities given by logistic function of decision function', :aggregate_failures do
+      param = { solver_type: Numo::Liblinear::SolverType::L2R_LR, C: 1 }
+      model = described_class.train(x, y, param)
+      df = described_class.decision_function(x_test, param, model)
+      pb = described_class.predict_proba(x_test, param, model)
+      sg = 1.0 / (1.0 + Numo::NMath.exp(-df))
+      expect((pb - (sg / sg.sum(axis: 1, keepdims: true))).abs.max).to be < 1e-12
+    end
+
+    it 'predicts labels with C-SVC trained by multiple threads', :aggregate_failures do
+      param = svc_param.merge(nr_thread: 4)
+      model = described_class.train(x, y, param)
+      pr = described_class.predict(x_test, param, model)
+      expect(pr.shape[0]).to eq(n_samples)
+      expect(accuracy(y_test, pr)).to be_within(0.05).of(0.95)
+    end
+
+    it 'trains the dual solvers by multiple threads to the serial solution', :aggregate_failures do
+      [Numo::Liblinear::SolverType::L2R_L2LOSS_SVC_DUAL, Numo::Liblinear::SolverType::L2R_LR_DUAL].each do |solver_type|
+        param = { solver_type: solver_type, C: 1, eps: 1e-3, random_seed: 1 }
+        w = described_class.train(x, y, param)[:w]
+        w_threads = described_class.train(x, y, param.merge(nr_thread: 4))[:w]
+        expect((w_threads - w).abs.max).to be < 1e-3 * w.abs.max
+      end
+    end
+
+    it 'predicts labels with L1-regularized logistic regression trained by multiple threads', :aggregate_failures do
+      param = { solver_type: Numo::Liblinear::SolverType::L1R_LR, C: 10, nr_thread: 4, random_seed: 1 }
+      model = described_class.train(x, y, param)
+      pr = described_class.predict(x_test, param, model)
+      expect(pr.shape[0]).to eq(n_samples)
+      expect(accuracy(y_test, pr)).to be_within(0.05).of(0.95)
+    end
+
+    it 'trains the L1-regularized solvers by multiple threads close to the serial solution', :aggregate_failures do
+      [Numo::Liblinear::SolverType::L1R_L2LOSS_SVC, Numo::Liblinear::SolverType::L1R_LR].each do |solver_type|
+        param = { solver_type: solver_type, C: 1, eps: 1e-4, random_seed: 1 }
+        w = described_class.train(x, y, param)[:w]
+        w_threads = described_class.train(x, y, param.merge(nr_thread: 4))[:w]
+        # w moves along the flat bottom of the L1 objective as much as eps allows
+        expect((w_threads - w).abs.max).to be < 5e-2 * w.abs.max
+      end
+    end
+
+    it 'trains C-SVC models along values of C', :aggregate_failures do
+      cs = Numo::DFloat[0.01, 0.1, 1, 10]
+      param = svc_param.merge(eps: 1e-3, keep_stat: true)
+      models = described_class.train_path(x, y, param, cs)
+      cold_models = cs.to_a.map { |c| described_class.train(x, y, param.merge(C: c)) }
+      expect(models.size).to eq(cs.size)
+      models.zip(cold_models).each do |model, cold_model|
+        expect((model[:w] - cold_model[:w]).abs.max).to be < 1e-3 * cold_model[:w].abs.max
+      end
+      # each model after the first starts from the dual variables of the one before
+      expect(models.sum { |m| m[:stat][:nr_iter] }).to be < cold_models.sum { |m| m[:stat][:nr_iter] }
+      pr = described_class.predict(x_test, svc_param.merge(C: cs[2]), models[2])
+      expect(accuracy(y_test, pr)).to be_within(0.05).of(0.95)
+    end
+
+    it 'retrains C-SVC from the kept dual variables', :aggregate_failures do
+      param = svc_param.merge(eps: 1e-3)
+      model = described_class.train(x, y, param.merge(keep_alpha: true))
+      n_cols = model[:alpha].size / x.shape[0]
+      expect(n_cols).to eq(n_classes)
+      alpha = model[:alpha].reshape(x.shape[0], n_cols)[10..-1, true]
+      init_alpha = Numo::NArray.vstack([alpha, Numo::DFloat.zeros(10, n_cols)]).flatten
+      x_new = Numo::NArray.vstack([x[10..-1, true], x[0...10, true]])
+      y_new = Numo::NArray.hstack([y[10..-1], y[0...10]])
+      warm_model = described_class.train(x_new, y_new, param.merge(init_alpha: init_alpha, keep_stat: true))
+      cold_model = described_class.train(x_new, y_new, param.merge(keep_stat: true))
+      expect(warm_model[:alpha]).to be_nil
+      expect(warm_model[:stat][:nr_iter]).to be < cold_model[:stat][:nr_iter]
+      expect((warm_model[:w] - cold_model[:w]).abs.max).to be < 1e-3
+      expect { described_class.train(x, y, svc_param.merge(init_alpha: Numo::DFloat.zeros(3))) }.to raise_error(ArgumentError)
+    end
+
+    it 'trains C-SVC on all positives and a sample of the negatives of each class', :aggregate_failures do
+      param = svc_param.merge(neg_ratio: 1)
+      model = described_class.train(x, y, param)
+      pr = described_class.predict(x_test, param, model)
+      expect(described_class.train(x, y, param)[:w]).to eq(model[:w])
+      expect((described_class.train(x, y, svc_param)[:w] - model[:w]).abs.max).to be > 0.1
+      expect(accuracy(y_test, pr)).to be_within(0.05).of(0.95)
+    end
+
+    it 'raises the cost of the sampled negatives by the inverse of the fraction kept', :aggregate_failures do
+      param = svc_param.merge(solver_type: Numo::Liblinear::SolverType::L2R_L1LOSS_SVC_DUAL, C: 0.01, neg_ratio: 1,
+                              keep_alpha: true, keep_stat: true)
+      model = described_class.train(x, y, param)
+      trace = model[:stat][:trace]
+      alpha = model[:alpha].reshape(x.shape[0], n_classes)
+      n_positives = Numo::Int32[*classes.sort.map { |label| y.eq(label).count }]
+      # the first pass of each binary problem runs over all of its samples
+      expect(trace[:active_size][trace[:iter].eq(1)]).to eq(n_positives * 2)
+      classes.sort.each_with_index do |label, k|
+        negative_c = 0.01 * (x.shape[0] - n_positives[k]) / n_positives[k]
+        expect(alpha[y.ne(label).where, k].max).to be_within(1e-12).of(negative_c)
+        expect(alpha[y.eq(label).where, k].max).to be <= 0.01
+      end
+    end
+
+    it 'stops training C-SVC at the time limit', :aggregate_failures do
+      model = described_class.train(x, y, svc_param.merge(max_time: 1e-9))
+      expect(model[:stopped_early]).to be(true)
+      expect(model[:w].size).to eq(svc_model[:w].size)
+      expect(svc_model[:stopped_early]).to be(false)
+    end
+
+    it 'keeps the counters and iteration trace of training', :aggregate_failures do
+      model = described_class.train(x, y, logit_param.merge(solver_type: Numo::Liblinear::SolverType::L2R_LR, keep_stat: true))
+      stat = model[:stat]
+      expect(stat[:nr_solve]).to eq(n_classes)
+      expect(stat[:nr_cg_iter]).to be >= stat[:nr_iter]
+      expect(stat[:time_Hv]).to be <= stat[:time]
+      expect(stat[:trace][:iter].size).to eq(stat[:nr_iter])
+      expect(stat[:trace][:solve].max).to eq(n_classes - 1)
+      expect(stat[:trace][:obj].isnan.count_true).to eq(0)
+      expect(svc_model[:stat]).to be_nil
+    end
+
+    it 'estimates the peak memory of training', :aggregate_failures do
+      param = { solver_type: Numo::Liblinear::SolverType::L1R_LR, keep_stat: true }
+      memory = described_class.train(x, y, param)[:stat][:memory]
+      estimate = described_class.estimate_memory(x.shape, x.ne(0).count, param, n_classes)
+      expect(memory[:input]).to eq(estimate[:input])
+      expect(memory[:setup]).to eq(estimate[:setup])
+      expect(memory[:transpose]).to be_between(memory[:setup], estimate[:transpose])
+      expect(memory[:solve]).to be <= estimate[:solve]
+      expect(memory[:peak]).to be_between(memory[:input] + memory[:problem], estimate[:peak])
+    end
+
+    it 'trains C-SVC on blocks of a file', :aggregate_failures do
+      Dir.mktmpdir do |dir|
+        filename = File.join(dir, 'train.blk')
+        half = x.shape[0] / 2
+        described_class.save_block(filename, x[0...half, true], y[0...half])
+        described_class.save_block(filename, x[half..-1, true], y[half..-1])
+        model = described_class.train_blocks(filename, svc_param)
+        pr = described_class.predict(x_test, svc_param, model)
+        expect(model[:nr_class]).to eq(n_classes)
+        expect(accuracy(y_test, pr)).to be_within(0.05).of(0.95)
+      end
+    end
+
+    it 'trains on three blocks of a file to the solution of training in memory', :aggregate_failures do
+      Dir.mktmpdir do |dir|
+        [Numo::Liblinear::SolverType::L2R_L2LOSS_SVC_DUAL, Numo::Liblinear::SolverType::L2R_L1LOSS_SVC_DUAL,
+         Numo::Liblinear::SolverType::L2R_LR_DUAL].each do |solver_type|
+          filename = File.join(dir, "train#{solver_type}.blk")
+          save_blocks(filename, x, y, 3)
+          param = { solver_type: solver_type, C: 0.1, eps: 1e-3, random_seed: 1 }
+          model = described_class.train_blocks(filename, param)
+          expect((model[:w] - described_class.train(x, y, param)[:w]).abs.max).to be < 1e-3
+        end
+      end
+    end
+
+    it 'rejects a block file with bytes appended or cut short', :aggregate_failures do
+      Dir.mktmpdir do |dir|
+        filename = File.join(dir, 'train.blk')
+        save_blocks(filename, x, y, 3)
+        File.open(filename, 'ab') { |f| f.write('LL') }
+        expect { described_class.train_blocks(filename, svc_param) }.to raise_error(IOError)
+        File.truncate(filename, File.size(filename) - 18)
+        expect { described_class.train_blocks(filename, svc_param) }.to raise_error(IOError)
+      end
+    end
+
+    it 'raises IOError for a block with a feature index out of range' do
+      Dir.mktmpdir do |dir|
+        filename = File.join(dir, 'train.blk')
+        described_class.save_block(filename, x[0...40, true], y[0...40])
+        first_block_size = File.size(filename)
+        described_class.save_block(filename, x[40...80, true], y[40...80])
+        described_class.save_block(filename, x[80..-1, true], y[80..-1])
+        # the first node of the second block follows its header of 20 bytes and its labels
+        File.open(filename, 'r+b') do |f|
+          f.seek(first_block_size + 20 + (8 * 40))
+          f.write([x.shape[1] + 3].pack('l'))
+        end
+        expect { described_class.train_blocks(filename, svc_param) }.to raise_error(IOError)
+      end
+    end
+
     it 'performs 5-cross validation with C-SVC', :aggregate_failures do
       pr = described_class.cv(x, y, svc_param, 5)
       expect(accuracy(y, pr)).to be_within(0.05).of(0.85)
@@ -114,6 +399,45 @@ RSpec.describe Numo::Liblinear do
       expect(err).to be <= 1e-8
     end
 
+    it 'trains SVR by multiple threads to the serial solution', :aggregate_failures do
+      x_scaled = x / x.abs.max(axis: 0)
+      [Numo::Liblinear::SolverType::L2R_L2LOSS_SVR_DUAL,
+       Numo::Liblinear::SolverType::L2R_L1LOSS_SVR_DUAL].each do |solver_type|
+        param = svr_param.merge(solver_type: solver_type, eps: 1e-4)
+        w = described_class.train(x_scaled, y, param)[:w]
+        w_threads = described_class.train(x_scaled, y, param.merge(nr_thread: 4))[:w]
+        expect((w_threads - w).abs.max).to be < 1e-2 * w.abs.max
+      end
+    end
+
+    it 'trains SVR on three blocks of a file to the solution of training in memory', :aggregate_failures do
+      x_scaled = x / x.abs.max(axis: 0)
+      Dir.mktmpdir do |dir|
+        [Numo::Liblinear::SolverType::L2R_L2LOSS_SVR_DUAL,
+         Numo::Liblinear::SolverType::L2R_L1LOSS_SVR_DUAL].each do |solver_type|
+          filename = File.join(dir, "train#{solver_type}.blk")
+          save_blocks(filename, x_scaled, y, 3)
+          param = svr_param.merge(solver_type: solver_type, eps: 1e-4)
+          model = described_class.train_blocks(filename, param)
+          expect((model[:w] - described_class.train(x_scaled, y, param)[:w]).abs.max).to be < 1e-2
+        end
+      end
+    end
+
+    it 'predicts target values with the quantized model of SVR', :aggregate_failures do
+      df = described_class.decision_function(x_test, svr_param, svr_model)
+      [8, 16].each do |bits|
+        qmodel = described_class.quantize(x_test, svr_param, svr_model, bits)
+        qdf = described_class.decision_function_quantized(x_test, qmodel)
+        expect(qmodel[:label]).to be_nil
+        expect((qdf - df).abs.max).to be <= qmodel[:max_error] + 1e-12
+        expect(described_class.predict_quantized(x_test, qmodel)).to eq(qdf)
+      end
+      # a single scale over the unscaled features leaves the small weights few bits at 8 bits
+      qmodel = described_class.quantize(x_test, svr_param, svr_model, 16)
+      expect(qmodel[:max_error]).to be < 1e-2 * df.abs.max
+    end
+
     it 'performs 5-cross validation with SVR', :aggregate_failures do
       pr = described_class.cv(x, y, svr_param, 5)
       expect(r2_score(y, pr)).to be >= 0.1
@@ -148,6 +472,28 @@ RSpec.describe Numo::Liblinear do
       expect(pr.shape[1]).to be_nil
       expect(accuracy(y_neg, pr)).to be >= 0.9
     end
+
+    it 'predicts labels with the quantized model of one-class SVM', :aggregate_failures do
+      df = described_class.decision_function(x_neg, oc_svm_param, oc_svm_model)
+      pr = described_class.predict(x_neg, oc_svm_param, oc_svm_model)
+      [8, 16].each do |bits|
+        qmodel = described_class.quantize(x_neg, oc_svm_param, oc_svm_model, bits)
+        qdf = described_class.decision_function_quantized(x_neg, qmodel)
+        expect(qmodel[:rho]).to eq(oc_svm_model[:rho])
+        expect((qdf - df).abs.max).to be <= qmodel[:max_error] + 1e-12
+        expect(described_class.predict_quantized(x_neg, qmodel)).to eq(pr)
+      end
+    end
+
+    it 'trains one-class SVM by multiple threads to the same model as the serial solver', :aggregate_failures do
+      x_test = dataset[2]
+      param = oc_svm_param.merge(nr_thread: 4)
+      model = described_class.train(x_pos, y_pos, param)
+      expect(model[:w]).to eq(oc_svm_model[:w])
+      expect(model[:rho]).to eq(oc_svm_model[:rho])
+      pr = described_class.predict(x_test, oc_svm_param, oc_svm_model)
+      expect(described_class.predict(x_test, param, model)).to eq(pr)
+    end
   end
 
   describe 'errors' do
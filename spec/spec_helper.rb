@@ -2,6 +2,7 @@
 
 require 'bundler/setup'
 require 'numo/liblinear'
+require 'tmpdir'
 
 if defined?(GC.verify_compaction_references) == 'method'
   GC.verify_compaction_references(double_heap: true, toward: :empty)
@@ -17,6 +18,15 @@ def r2_score(y_true, y_pred)
   denominator.zero? ? 0.0 : 1.0 - (numerator / denominator)
 end
 
+def save_blocks(filename, x, y, n_blocks)
+  n_samples = x.shape[0]
+  block_size = (n_samples + n_blocks - 1) / n_blocks
+  (0...n_samples).step(block_size) do |s|
+    e = [s + block_size, n_samples].min
+    Numo::Liblinear.save_block(filename, x[s...e, true], y[s...e])
+  end
+end
+
 RSpec.configure do |config|
   # Enable flags like --only-failures and --next-failure
   config.example_status_persistence_file_path = '.rspec_status'